@@ -32,7 +32,112 @@ Modified by Nishka Dasgupta, Akash Shah
 #include "OT/np.h"
 #include "OT/ot.h"
 #include <algorithm>
+#include <immintrin.h>
 namespace sci {
+
+/*
+Branch-free arithmetic modulo a small prime p < 256 for byte-sized shares.
+Values are reduced with a 16-bit Barrett step (m = floor(2^16 / p)) followed
+by a single conditional subtraction.
+*/
+inline uint16_t smallmod_barrett(const uint8_t smallmod) {
+  return (uint16_t)(65536 / smallmod);
+}
+
+// x mod p for any byte-sized x
+inline uint8_t smallmod_reduce(uint16_t x, const uint8_t smallmod,
+                               const uint16_t m) {
+  uint16_t q = (uint16_t)(((uint32_t)x * m) >> 16);
+  uint16_t r = x - q * smallmod;
+  r -= smallmod & -(uint16_t)(r >= smallmod);
+  return (uint8_t)r;
+}
+
+/*
+The same for a prime p < 2^16 and two-byte shares, with m = floor(2^32 / p).
+The overloads are picked by the width of the modulus.
+*/
+inline uint32_t smallmod_barrett(const uint16_t smallmod) {
+  return (uint32_t)(4294967296ULL / smallmod);
+}
+
+// x mod p for any two-byte x
+inline uint16_t smallmod_reduce(uint16_t x, const uint16_t smallmod,
+                                const uint32_t m) {
+  uint32_t q = (uint32_t)(((uint64_t)x * m) >> 32);
+  uint32_t r = x - q * smallmod;
+  r -= smallmod & -(uint32_t)(r >= smallmod);
+  return (uint16_t)r;
+}
+
+// Low bits of a hash block, as many as the shares have
+inline uint8_t smallmod_bits(const block128 &b, uint8_t) {
+  return (uint8_t)_mm_extract_epi8(b, 0);
+}
+
+inline uint16_t smallmod_bits(const block128 &b, uint16_t) {
+  return (uint16_t)_mm_extract_epi16(b, 0);
+}
+
+/*
+Final step of the boolean to arithmetic conversion over Z_p:
+- sender:   a[i] = (z[i] + 2*a[i]) mod p, where a[i] < p
+- receiver: a[i] = (z[i] - 2*a[i]) mod p, where a[i] is any byte
+*/
+inline void smallmod_b2a(uint8_t *a, const uint8_t *z, const int length,
+                         const uint8_t smallmod, const bool negate) {
+  const uint16_t m = smallmod_barrett(smallmod);
+  int i = 0;
+#ifdef __AVX2__
+  const __m256i vp = _mm256_set1_epi16(smallmod);
+  const __m256i vm = _mm256_set1_epi16((short)m);
+  for (; i + 16 <= length; i += 16) {
+    __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(a + i)));
+    __m256i vz = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(z + i)));
+    if (negate) {
+      __m256i q = _mm256_mulhi_epu16(va, vm);
+      va = _mm256_sub_epi16(va, _mm256_mullo_epi16(q, vp));
+      va = _mm256_min_epu16(va, _mm256_sub_epi16(va, vp));
+      va = _mm256_sub_epi16(vp, va);
+    }
+    // z + 2v < 3p, two conditional subtractions
+    __m256i v = _mm256_add_epi16(vz, _mm256_add_epi16(va, va));
+    v = _mm256_min_epu16(v, _mm256_sub_epi16(v, vp));
+    v = _mm256_min_epu16(v, _mm256_sub_epi16(v, vp));
+    __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(v),
+                                      _mm256_extracti128_si256(v, 1));
+    _mm_storeu_si128((__m128i *)(a + i), packed);
+  }
+#endif
+  for (; i < length; i++) {
+    uint16_t v = a[i];
+    if (negate)
+      v = smallmod - smallmod_reduce(v, smallmod, m);
+    v = z[i] + 2 * v;
+    v -= smallmod & -(uint16_t)(v >= smallmod);
+    v -= smallmod & -(uint16_t)(v >= smallmod);
+    a[i] = (uint8_t)v;
+  }
+}
+
+/*
+Final step of the boolean to arithmetic conversion over Z_p for two-byte shares,
+same as above with a[i] any two-byte value on the receiver side
+*/
+inline void smallmod_b2a(uint16_t *a, const uint8_t *z, const int length,
+                         const uint16_t smallmod, const bool negate) {
+  const uint32_t m = smallmod_barrett(smallmod);
+  for (int i = 0; i < length; i++) {
+    uint32_t v = a[i];
+    if (negate)
+      v = smallmod - smallmod_reduce(a[i], smallmod, m);
+    v = z[i] + 2 * v;
+    v -= smallmod & -(uint32_t)(v >= smallmod);
+    v -= smallmod & -(uint32_t)(v >= smallmod);
+    a[i] = (uint16_t)v;
+  }
+}
+
 template <typename IO> class IKNP : public OT<IKNP<IO>> {
 public:
   OTNP<IO> *base_ot;
@@ -714,8 +819,9 @@ public:
 
   template <typename intType>
   void cot_send_post_moduloAdd(intType *rdata, const intType *delta,
-                               const int length, const uint8_t smallmod) {
+                               const int length, const intType smallmod) {
     const int bsize = AES_BATCH_SIZE / 2;
+    const auto m = smallmod_barrett(smallmod);
     block128 pad[2 * bsize];
     intType tmp[bsize];
     for (int i = 0; i < length; i += bsize) {
@@ -725,16 +831,12 @@ public:
       }
       crh.H<2 * bsize>(pad, pad);
       for (int j = i; j < i + bsize and j < length; ++j) {
-        rdata[j] =
-            (intType)_mm_extract_epi8(pad[2 * (j - i)], 0); // Use lower bits
-	while(rdata[j] >= smallmod) {
-		rdata[j] -= smallmod;
-	}
+        rdata[j] = smallmod_reduce(smallmod_bits(pad[2 * (j - i)], smallmod),
+                                   smallmod, m); // Use lower bits
+        // delta[j] < smallmod, so a single conditional subtraction suffices
         intType corrVal = rdata[j] + delta[j];
-        while(corrVal >= smallmod) {
-            corrVal = corrVal - smallmod;
-        }
-        intType mask = (intType)_mm_extract_epi8(pad[2 * (j - i) + 1], 0);
+        corrVal -= smallmod & -(intType)(corrVal >= smallmod);
+        intType mask = smallmod_bits(pad[2 * (j - i) + 1], smallmod);
         intType msgToBeSent = corrVal ^ mask;
         tmp[j - i] = msgToBeSent;
       }
@@ -756,8 +858,7 @@ public:
       else
         crh.Hn(hashes, tT + i, length - i);
       for (int j = 0; j < bsize and j < length - i; ++j) {
-        data[i + j] = (intType)_mm_extract_epi8(
-            hashes[j], 0); // Use lower bits convention
+        data[i + j] = smallmod_bits(hashes[j], intType()); // Use lower bits convention
         if (choices[i + j]) {
           data[i + j] = data[i + j] ^ res[j];
         }
@@ -771,7 +872,7 @@ public:
   */
   template <typename intType>
   void send_cot_moduloAdd(intType *rdata, const intType *delta,
-                          const int numOTs, const uint8_t smallmod) {
+                          const int numOTs, const intType smallmod) {
     send_pre(numOTs);
     cot_send_post_moduloAdd<intType>(rdata, delta, numOTs, smallmod);
   }
@@ -0,0 +1,116 @@
+#ifndef MPCHONESTMAJORITY_BATCHMATRIX_H
+#define MPCHONESTMAJORITY_BATCHMATRIX_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#define BATCH_MATRIX_TILE 64 //vectors per tile, a tile of inputs and outputs stays in cache across the rows
+
+using namespace std;
+
+/**
+ * A dense rows x cols matrix over FieldType that is applied to many vectors at once, instead of one
+ * MatrixMult call per bucket. Vector b is read from in[(b*cols + j)*step] and written to out[(b*rows + i)*step],
+ * so with step > 1 several interleaved batches (e.g. T and 2T sharings) are handled by calls at offsets 0..step-1.
+ * The vectors are processed in tiles of BATCH_MATRIX_TILE, and the common numbers of columns (party counts
+ * 3, 5, 7, 10, 15) get a specialization with a compile-time inner loop.
+ */
+template <class FieldType>
+class BatchMatrix {
+
+private:
+    int rows = 0;
+    int cols = 0;
+    vector<FieldType> coef;//row major
+
+    template <int COLS>
+    void applyFixed(FieldType *in, FieldType *out, uint64_t count, int step);
+    void applyGeneric(FieldType *in, FieldType *out, uint64_t count, int step);
+
+public:
+    void allocate(int numRows, int numCols) {
+        rows = numRows;
+        cols = numCols;
+        coef.resize(rows*cols);
+    }
+
+    FieldType &at(int i, int j) { return coef[i*cols + j]; }
+    int getRows() { return rows; }
+    int getCols() { return cols; }
+
+    void apply(FieldType *in, FieldType *out, uint64_t count, int step = 1);
+};
+
+template <class FieldType>
+void BatchMatrix<FieldType>::apply(FieldType *in, FieldType *out, uint64_t count, int step) {
+
+    switch (cols) {
+        case 3:
+            applyFixed<3>(in, out, count, step);
+            break;
+        case 5:
+            applyFixed<5>(in, out, count, step);
+            break;
+        case 7:
+            applyFixed<7>(in, out, count, step);
+            break;
+        case 10:
+            applyFixed<10>(in, out, count, step);
+            break;
+        case 15:
+            applyFixed<15>(in, out, count, step);
+            break;
+        default:
+            applyGeneric(in, out, count, step);
+    }
+}
+
+template <class FieldType>
+template <int COLS>
+void BatchMatrix<FieldType>::applyFixed(FieldType *in, FieldType *out, uint64_t count, int step) {
+
+    FieldType row[COLS];
+
+    for (uint64_t start = 0; start < count; start += BATCH_MATRIX_TILE) {
+        uint64_t end = min(count, start + BATCH_MATRIX_TILE);
+
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < COLS; j++) {
+                row[j] = coef[i*COLS + j];
+            }
+
+            for (uint64_t b = start; b < end; b++) {
+                FieldType *v = in + b*COLS*step;
+                FieldType acc = row[0] * v[0];
+                for (int j = 1; j < COLS; j++) {
+                    acc += row[j] * v[j*step];
+                }
+                out[(b*rows + i)*step] = acc;
+            }
+        }
+    }
+}
+
+template <class FieldType>
+void BatchMatrix<FieldType>::applyGeneric(FieldType *in, FieldType *out, uint64_t count, int step) {
+
+    for (uint64_t start = 0; start < count; start += BATCH_MATRIX_TILE) {
+        uint64_t end = min(count, start + BATCH_MATRIX_TILE);
+
+        for (int i = 0; i < rows; i++) {
+            FieldType *row = coef.data() + i*cols;
+
+            for (uint64_t b = start; b < end; b++) {
+                FieldType *v = in + b*cols*step;
+                FieldType acc = row[0] * v[0];
+                for (int j = 1; j < cols; j++) {
+                    acc += row[j] * v[j*step];
+                }
+                out[(b*rows + i)*step] = acc;
+            }
+        }
+    }
+}
+
+#endif //MPCHONESTMAJORITY_BATCHMATRIX_H
@@ -24,6 +24,7 @@
  */
 
 #include "ProtocolParty2.h"
+#include <algorithm>
 
 template <class FieldType>
 class CircuitPSI : public ProtocolParty<FieldType>{
@@ -40,8 +41,7 @@ class CircuitPSI : public ProtocolParty<FieldType>{
 		 *
 		 * Methods:
 		 * Constructor
-		 * roundFunctionSync, exchangeData, roundFunctionSyncBroadcast, recData, roundFunctionSyncForP1,
-		 *   recDataToP1, sendDataToP1, sendFromP1
+		 * roundFunctionSync, roundFunctionSyncBroadcast, roundFunctionSyncForP1, sendFromP1, scatterFromP1
 		 * run, runOffline, runOnline
 		 * readMyInputs
 		 * initialisationPhase
@@ -61,8 +61,19 @@ class CircuitPSI : public ProtocolParty<FieldType>{
     		uint64_t prime_val; //Prime modulus of the field
 		uint64_t prime_bitlen;
 		uint64_t triple_ctr; //number of multiplication triples per bin
+		uint64_t width; //shared values per vector of bins: num_bins, or the number of packs with packed sharing
 		vector<uint64_t> sindex; //indices where the bit representation of the prime has bit 1
 
+		//one multiplication of the exponentiation: slot out = slot left * slot right
+		struct MultStep {
+			int left;
+			int right;
+			int out;
+		};
+		vector<vector<MultStep>> mult_schedule; //the multiplications of each round of computeIntersectionShares
+		int num_slots; //slot i <= sindex.back() holds x^(2^i), the others partial products
+		int result_slot; //slot holding x^(p-1)
+
 		uint64_t num_bins; // number of bins
 		uint64_t num_triples;//number of multiplication triples
 		uint64_t sent_bytes; //total number of bytes sent
@@ -73,19 +84,27 @@ class CircuitPSI : public ProtocolParty<FieldType>{
 		vector<FieldType> a_vals; //threshold shares of a_j
 		vector<FieldType> outputs; //the shares of s_j*a_j
 		vector<FieldType> randomTAndAddShares; //shares of r_j for conversion of inputs to T-sharings
+		string conversionType; //additive-to-threshold conversion: Leader (open at P0 and reshare) or Direct (every party shares)
 		vector<FieldType> cpsi_outputs; //shares of multiplication output of polynomial for threshold
 
 		CircuitPSI(int argc, char* argv[]);
 
 		//read num_bins MPSI inputs
-		void readMPSIInputs(vector<vector<uint8_t>>& bins, uint64_t nbins);
+		template <class ShareType>
+		void readMPSIInputs(vector<vector<ShareType>>& bins, uint64_t nbins);
 
 		//convert shares to field type for testing
 		void convertSharestoFieldType(vector<uint8_t>& bins, vector<FieldType>& shares, uint64_t nbins);
 
-		//perform MPSI
+		//perform MPSI (offline followed by online)
 		uint64_t runMPSI();
 
+		//input-independent preprocessing for nbins bins; may run while the OPPRF phase is in progress
+		void runMPSIOffline(uint64_t nbins);
+
+		//evaluate the circuit on the inputs read by readMPSIInputs using the preprocessed randomness
+		uint64_t runMPSIOnline();
+
 		//prepare additive and T-threshold sharings of secret random value r_j using DN07's protocol
 		void modDoubleRandom(uint64_t no_random, vector<FieldType>& randomElementsToFill);
 
@@ -98,6 +117,9 @@ class CircuitPSI : public ProtocolParty<FieldType>{
 		//convert parties' additive shares to T-threshold shares
 		void additiveToThreshold();
 
+		//precompute a minimum-depth multiplication schedule for x^(p-1)
+		void scheduleExponentiation();
+
 		//Compute shares of the intersection
 		void computeIntersectionShares();
 
@@ -134,6 +156,8 @@ template <class FieldType> CircuitPSI<FieldType>::CircuitPSI(int argc, char* arg
 	prime_val = (uint64_t)stoi(parser.getValueByKey(this->arguments, "primemod"));
 	prime_bitlen = (uint64_t)(ceil(log2(prime_val)));
 
+	conversionType = parser.getValueByKey(this->arguments, "conversionType");
+
 	sent_bytes = 0;
 	recv_bytes = 0;
 
@@ -155,12 +179,52 @@ template <class FieldType> CircuitPSI<FieldType>::CircuitPSI(int argc, char* arg
 	}
 
 	triple_ctr = prime_bitlen + sindex.size() - 2;
+	scheduleExponentiation();
+}
+
+/*
+ * Schedule the multiplications of x^(p-1) in rounds:
+ * round r squares x^(2^(r-1)) and, in the same batch, multiplies pairs of
+ * selected powers or partial products that are ready. The two partial
+ * products that become ready first are always combined first, which gives
+ * the minimum depth for the ready times of the squares.
+ * For p = 31 this takes 5 rounds instead of 4 squarings + 3 products.
+ */
+template <class FieldType> void CircuitPSI<FieldType>::scheduleExponentiation() {
+	int top = sindex.back();
+	mult_schedule.assign(top + sindex.size(), vector<MultStep>());
+
+	for(int r = 1; r <= top; r++) {
+		mult_schedule[r-1].push_back({r-1, r-1, r});
+	}
+
+	//(round after which the value is ready, slot)
+	vector<pair<int, int>> pool;
+	for(uint64_t i = 0; i < sindex.size(); i++) {
+		pool.push_back(make_pair((int)sindex[i], (int)sindex[i]));
+	}
+
+	num_slots = top + 1;
+	while(pool.size() > 1) {
+		sort(pool.begin(), pool.end());
+		int round = max(pool[0].first, pool[1].first) + 1;
+		mult_schedule[round-1].push_back({pool[0].second, pool[1].second, num_slots});
+		pool.erase(pool.begin(), pool.begin() + 2);
+		pool.push_back(make_pair(round, num_slots));
+		num_slots++;
+	}
+	result_slot = pool[0].second;
+
+	while(!mult_schedule.empty() && mult_schedule.back().empty()) {
+		mult_schedule.pop_back();
+	}
 }
 
 /*
  * read num_bins MPSI inputs from arguments
  */
-template <class FieldType> void CircuitPSI<FieldType>::readMPSIInputs(vector<vector<uint8_t>>& bins, uint64_t nbins) {
+template <class FieldType> template <class ShareType>
+void CircuitPSI<FieldType>::readMPSIInputs(vector<vector<ShareType>>& bins, uint64_t nbins) {
 	uint8_t input;
 	uint64_t i = 0;
 	uint64_t j = 0;
@@ -215,12 +279,21 @@ template <class FieldType> void CircuitPSI<FieldType>::convertSharestoFieldType(
  * Initialize parameters and shared randomness and call circuit evaluation method
  */
 template <class FieldType> uint64_t CircuitPSI<FieldType>::runMPSI() {
-	uint64_t counter = 0;
-	masks.resize(num_bins);
-	a_vals.resize(num_bins);
-	outputs.resize(num_bins);
-	cpsi_outputs.resize(num_bins);
-	num_triples = triple_ctr * num_bins;
+	runMPSIOffline(num_bins);
+	return runMPSIOnline();
+}
+
+/*
+ * Generate the input-independent shared randomness for nbins bins
+ */
+template <class FieldType> void CircuitPSI<FieldType>::runMPSIOffline(uint64_t nbins) {
+	num_bins = nbins;
+	width = this->numPacks(num_bins);
+	masks.resize(width);
+	a_vals.resize(width);
+	outputs.resize(width * this->packFactor);
+	cpsi_outputs.resize(width);
+	num_triples = triple_ctr * width;
 	
 	auto t1 = high_resolution_clock::now();
 	this->honestMult->invokeOffline();
@@ -228,26 +301,40 @@ template <class FieldType> uint64_t CircuitPSI<FieldType>::runMPSI() {
 	auto dur1 = duration_cast<milliseconds>(t2-t1).count();
 	//cout << this->m_partyId << ": Time to initialise matrices is: " << dur1 << " milliseconds." << endl;
 
-	//Generate random T-sharings
+	//Generate random T-sharings, additive and T-sharings and T and 2T sharings for multiplication
 	auto t3 = high_resolution_clock::now();
-	this->generateRandomShares(num_bins, masks);
+	if(this->packFactor > 1) {
+		//random T-sharings are random packed sharings, the multiplications need packed double sharings
+		if(this->genRandomSharesType == "PRSS") {
+			this->generateRandomSharesPRSS(width, masks);
+		}
+		else {
+			this->generateRandomShares(width, masks);
+		}
+		this->generatePackedDoubleShares(num_triples, this->randomTAnd2TShares);
+	}
+	else if(this->genRandomSharesType == "PRSS") {
+		this->generateRandomSharesPRSS(num_bins, masks);
+		if(conversionType != "Direct") {
+			modDoubleRandom(num_bins, randomTAndAddShares);
+		}
+		this->generateRandom2TAndTSharesPRSS(num_triples, this->randomTAnd2TShares);
+	}
+	else {
+		//all three kinds are dealt in one round, sized by the number of multiplications of the circuit
+		this->generateFusedShares(num_bins, conversionType != "Direct" ? num_bins : 0, num_triples,
+				masks, randomTAndAddShares, this->randomTAnd2TShares);
+	}
 	auto t4 = high_resolution_clock::now();
 	auto dur2 = duration_cast<milliseconds>(t4-t3).count();
-	//cout << this->m_partyId << ": T-sharings generated in " << dur3 << "milliseconds." << endl;
-	
-	//Generate random additive and T-sharings
-	auto t5 = high_resolution_clock::now();
-	modDoubleRandom(num_bins, randomTAndAddShares);
-	auto t6 = high_resolution_clock::now();
-	auto dur3 = duration_cast<milliseconds>(t6-t5).count();
-	//cout << this->m_partyId << ": T- and additive sharings generated in " << dur2 << " milliseconds." << endl;
-
-	//Generate random T and 2T sharings for multiplication
-	auto t7 = high_resolution_clock::now();
-	this->generateRandom2TAndTShares(num_triples, this->randomTAnd2TShares);
-	auto t8 = high_resolution_clock::now();
-	auto dur4 = duration_cast<milliseconds>(t8-t7).count();
-	//cout << this->m_partyId << ": T- and 2T-sharings generated in " << dur4 << " milliseconds." << endl;
+	//cout << this->m_partyId << ": random sharings generated in " << dur2 << " milliseconds." << endl;
+}
+
+/*
+ * Execute the protocol on the inputs; runMPSIOffline must have completed
+ */
+template <class FieldType> uint64_t CircuitPSI<FieldType>::runMPSIOnline() {
+	uint64_t counter = 0;
 
         //Evaluate the circuit
 	counter = evaluateCircuit();
@@ -259,12 +346,15 @@ template <class FieldType> uint64_t CircuitPSI<FieldType>::runMPSI() {
  */
 template <class FieldType> void CircuitPSI<FieldType>::modDoubleRandom(uint64_t no_random, vector<FieldType>& randomElementsToFill) {
 	//cout << this->m_partyId <<  ": Generating double sharings..." << endl;
-	int index = 0;
+	if(this->genRandomSharesType == "PRSS") {
+		//derived locally from the PRSS subset keys, no communication
+		this->generateRandomTAndAddSharesPRSS(no_random, randomElementsToFill);
+		return;
+	}
 	int N = this->N;
 	int T = this->T;
         //TemplateField<FieldType> &field = this->field;
 
-	vector<FieldType> x1(N), y1(N), y2(N), t1(N), r1(N), t2(N), r2(N);
 	vector<vector<FieldType>> sendBufsElements(N);
 	vector<vector<byte>> sendBufsBytes(N);
         vector<vector<byte>> recBufsBytes(N);
@@ -289,57 +379,53 @@ template <class FieldType> void CircuitPSI<FieldType>::modDoubleRandom(uint64_t
          *  first degree T, then additive
          *
          */
+	//the shares of the T parties after me are expanded from seeds, at 2k for degree T and 2k+1 for additive
+	vector<vector<byte>> seeds;
+	vector<vector<FieldType>> seededShares;
+	this->beginSeededDealing(no_buckets*2, seeds, seededShares);
+
+	// random field elements, uniform distribution,
+	// the secret and the seeded shares fix each degree-T polynomial
+	vector<FieldType> secrets(no_buckets);
 	for(uint64_t k=0; k < no_buckets; k++) {
-                // generate random degree-T polynomial
-		for(int i = 0; i < T+1; i++) {
-                        // A random field element, uniform distribution,
-                        // note that x1[0] is the secret which is also random
-			x1[i] = this->field->Random();
-		}
-		
-		this->matrix_vand.MatrixMult(x1, y1,T+1); // eval poly at alpha-positions
-
-		y2[0] = x1[0];
-                // generate N-1 random elements
-		for(int i = 1; i < N; i++) {
-                        // A random field element, uniform distribution
-			y2[i] = this->field->Random();
-                        //all y2[i] generated so far are additive shares of the secret x1[0]
-			y2[0] = y2[0] - y2[i];
-		}
-		//testShareGenNoComm(y1, y2);
+		secrets[k] = this->field->Random();
+	}
 
-                // prepare shares to be sent
-		for(int i=0; i < N; i++) {
-                        //cout << "y1[ " <<i<< "]" <<y1[i] << " y2[ " << i << "]" << y2[i] << "\n";
-			sendBufsElements[i][2*k] = y1[i];
-			sendBufsElements[i][2*k + 1] = y2[i];
+	this->seededSharings(secrets.data(), T, seededShares, 0, 2, no_buckets, sendBufsElements);
+
+	for(uint64_t k=0; k < no_buckets; k++) {
+		FieldType mine = secrets[k];
+		// generate N-1 random elements, the seeded parties expand theirs
+		for(int i = 0; i < N; i++) {
+			if(i == this->m_partyId) {
+				continue;
+			}
+			if(this->isSeeded(this->m_partyId, i)) {
+				sendBufsElements[i][2*k + 1] = seededShares[i][2*k + 1];
+			}
+			else {
+				// A random field element, uniform distribution
+				sendBufsElements[i][2*k + 1] = this->field->Random();
+			}
+			//all shares generated so far are additive shares of the secret
+			mine = mine - sendBufsElements[i][2*k + 1];
 		}
+		sendBufsElements[this->m_partyId][2*k + 1] = mine;
 	}
 
 	for(int i=0; i < N; i++) {
-		for(uint64_t j=0; j<sendBufsElements[i].size();j++) {
-			this->field->elementToBytes(sendBufsBytes[i].data() + (j * fieldByteSize), sendBufsElements[i][j]);
-		}
+		elementsToBytes(this->field, sendBufsBytes[i].data(), sendBufsElements[i].data(), sendBufsElements[i].size());
 	}
 
+	//seeded parties get their seed instead of their shares
+	this->compressSeededShares(sendBufsBytes, seeds);
+	this->resizeSeededReceive(recBufsBytes);
+
 	this->roundFunctionSync(sendBufsBytes, recBufsBytes, 1);
 
-	for(uint64_t k=0; k < no_buckets; k++) {
-		for (int i = 0; i < N; i++) {
-			t1[i] = this->field->bytesToElement(recBufsBytes[i].data() + (2*k * fieldByteSize));
-			t2[i] = this->field->bytesToElement(recBufsBytes[i].data() + ((2*k +1) * fieldByteSize));
-		}
-		this->matrix_vand_transpose.MatrixMult(t1, r1,N-T);
-		this->matrix_vand_transpose.MatrixMult(t2, r2,N-T);
-
-                //copy the resulting vector to the array of randoms
-		for (int i = 0; i < (N - T); i++) {
-			randomElementsToFill[index*2] = r1[i];
-			randomElementsToFill[index*2 +1] = r2[i];
-			index++;
-		}
-	}
+	this->expandSeededShares(recBufsBytes, no_buckets*2);
+
+	this->extractRandomShares(recBufsBytes, 0, no_buckets, 2, randomElementsToFill);
 
 	if (mpsi_print == true) {
 		cout << this->m_partyId << ": First pair of shares is " << randomElementsToFill[0] << " " << randomElementsToFill[1] << endl;
@@ -361,14 +447,11 @@ template <class FieldType> void CircuitPSI<FieldType>::addShareOpen(uint64_t num
 	vector<byte> sendBufsBytes;
 	vector<byte> aPlusRSharesBytes(num_vals*fieldByteSize);
 	int i;
-	uint64_t j;
 	int N = this->N;
 
 	secrets.resize(num_vals);
 
-	for(j=0; j<num_vals; j++) {
-		this->field->elementToBytes(aPlusRSharesBytes.data() + (j * fieldByteSize), shares[j]);
-	}
+	elementsToBytes(this->field, aPlusRSharesBytes.data(), shares.data(), num_vals);
 
 	if(this->m_partyId == 0) {
 		recBufsBytes.resize(N);
@@ -391,11 +474,11 @@ template <class FieldType> void CircuitPSI<FieldType>::addShareOpen(uint64_t num
 	//reconstruct the shares recieved from the other parties
 	if (this->m_partyId == 0) {
 
-		for (j = 0; j < num_vals; j++) {
-			secrets[j] = *(this->field->GetZero());
-			for (i = 0; i < N; i++) {
-				secrets[j] += this->field->bytesToElement(recBufsBytes[i].data() + (j * fieldByteSize));
-			}
+		secrets.assign(num_vals, *(this->field->GetZero()));
+		vector<FieldType> received(num_vals);
+		for (i = 0; i < N; i++) {
+			bytesToElements(this->field, received.data(), recBufsBytes[i].data(), num_vals);
+			batchAdd(secrets.data(), secrets.data(), received.data(), num_vals);
 		}
 	}
 }
@@ -408,66 +491,50 @@ template <class FieldType> void CircuitPSI<FieldType>::reshare(vector<FieldType>
 	int T = this->T;
 	uint64_t no_vals = vals.size();
 
-	vector<FieldType> x1(N), y1(N);
 	vector<vector<FieldType>> sendBufsElements(N);
 	vector<vector<byte>> sendBufsBytes(N);
-	vector<vector<byte>> recBufsBytes(N);
-	vector<vector<FieldType>> recBufsElements(N);
 
 	int fieldByteSize = this->field->getElementSizeInBytes();
 
 	if(this->m_partyId == 0) {
-                //generate T-sharings of the values in vals
-		for(uint64_t k = 0; k < no_vals; k++) {
-                        //set x1[0] as the secret to be shared
-			x1[0] = vals[k];
-                        // generate random degree-T polynomial
-			for(int i = 1; i < T+1; i++) {
-                                // A random field element, uniform distribution
-                                x1[i] = this->field->Random();
-			}
-
-			this->matrix_vand.MatrixMult(x1, y1,T+1); // eval poly at alpha-positions
+		//the T parties after the leader expand their shares from a seed
+		vector<vector<byte>> seeds;
+		vector<vector<FieldType>> seededShares;
+		this->beginSeededDealing(no_vals, seeds, seededShares);
 
-                        // prepare shares to be sent
-			for(int i=0; i < N; i++) {
-                                //cout << "y1[ " <<i<< "]" <<y1[i] << endl;
-				sendBufsElements[i].push_back(y1[i]);
+		//generate T-sharings of the values in vals, the secret and the seeded shares fix each polynomial
+		for(int i=0; i < N; i++) {
+			sendBufsElements[i].resize(no_vals);
+		}
+		this->seededSharings(vals.data(), T, seededShares, 0, 1, no_vals, sendBufsElements);
+		for(uint64_t k = 0; k < no_vals; k++) {
+			shares[k] = sendBufsElements[0][k];
+		}
+		for(int i=0; i < N; i++) {
+			if(this->isSeeded(0, i)) {
+				sendBufsElements[i].clear();
 			}
-			shares[k] = y1[0];
 		}
 
-		//cout << "Sharings generated \n";
-
 		for (int i=0; i<N; i++) {
 			sendBufsBytes[i].resize(sendBufsElements[i].size() * fieldByteSize);
-			recBufsBytes[i].resize(num_bins * fieldByteSize);
-			for(uint64_t j=0; j<sendBufsElements[i].size(); j++) {
-				this->field->elementToBytes(sendBufsBytes[i].data() + (j * fieldByteSize), sendBufsElements[i][j]);
-			}
-			//cout << sendBufsElements[i].size() << " " << sendBufsBytes[i].size() << " " << recBufsBytes[i].size();
+			elementsToBytes(this->field, sendBufsBytes[i].data(), sendBufsElements[i].data(), sendBufsElements[i].size());
 		}
-	}
-	else {
-		for (int i=0; i<N; i++) {
-			sendBufsBytes[i].resize(num_bins * fieldByteSize);
-			recBufsBytes[i].resize(num_bins * fieldByteSize);
-			for (uint64_t j=0; j<num_bins; j++) {
-				this->field->elementToBytes(sendBufsBytes[i].data(), *(this->field->GetZero()));
-			}
-		}
-	}
 
-	//cout << "byte conversion done \n";
+		this->compressSeededShares(sendBufsBytes, seeds);
 
-	this->roundFunctionSync(sendBufsBytes, recBufsBytes, 2);
-
-	//cout << "roundFunctionSync() done ";
-
-	if (this->m_partyId != 0) {
-		for(uint64_t k=0; k < no_vals; k++) {
-			shares[k] = this->field->bytesToElement(recBufsBytes[0].data() + (k * fieldByteSize));
-		}
+		//only the leader has data: each party receives its shares, nothing is sent back
+		this->scatterFromP1(sendBufsBytes);
+	}
+	else if(this->isSeeded(0, this->m_partyId)) {
+		vector<byte> seed(16);
+		this->parties[0]->getChannel()->read(seed.data(), seed.size());
+		this->expandSeed(seed.data(), no_vals, shares);
+	}
+	else {
+		vector<byte> recBytes(no_vals * fieldByteSize);
+		this->parties[0]->getChannel()->read(recBytes.data(), recBytes.size());
+		bytesToElements(this->field, shares.data(), recBytes.data(), no_vals);
 	}
 	//cout << "converted back to field elements...\n";
 
@@ -487,63 +554,76 @@ template <class FieldType> void CircuitPSI<FieldType>::reshare(vector<FieldType>
  * to get T-threshold shares of the original secret
  */
 template <class FieldType> void CircuitPSI<FieldType>::additiveToThreshold() {
-	uint64_t j;
+	if(this->packFactor > 1) {
+		//every party packs and T-shares its own additive shares, as in the Direct conversion
+		this->packSharings(add_a, a_vals);
+		return;
+	}
+	if(conversionType == "Direct") {
+		//every party T-shares its own additive share, the T-sharings are added locally
+		this->sumSharings(add_a, a_vals);
+		return;
+	}
+
 	vector<FieldType> reconar; // reconstructed aj+rj
 	reconar.resize(num_bins);
 
         //add additive share of rj to corresponding share of aj
-	for(j=0; j<num_bins; j++) {
-		add_a[j] = add_a[j] + randomTAndAddShares[j*2+1];
-	}
+	batchAdd(add_a.data(), add_a.data(), randomTAndAddShares.data() + 1, num_bins, 2);
 
-	//reconstruct additive shares, store in reconar
-	addShareOpen(num_bins, add_a, reconar);
+	if(this->kingRotation) {
+		//every party opens and reshares its own range of bins
+		this->kingAdditiveToThreshold(add_a.data(), num_bins, a_vals.data());
+	}
+	else {
+		//reconstruct additive shares, store in reconar
+		addShareOpen(num_bins, add_a, reconar);
 
-        //reshare and save in a_vals;
-	reshare(reconar, a_vals);
+		//reshare and save in a_vals;
+		reshare(reconar, a_vals);
+	}
 
 	//subtract rj
-	for(j=0; j<num_bins; j++) {
-		a_vals[j] = a_vals[j] - randomTAndAddShares[j*2];
-	}
+	batchSub(a_vals.data(), a_vals.data(), randomTAndAddShares.data(), num_bins, 2);
 }
 
 /*
  * Step 2 of the online phase:
  * Compute x^{p-1}
+ * following mult_schedule, with all multiplications of a round in one batch
  */
 template <class FieldType> void CircuitPSI<FieldType>::computeIntersectionShares() {
 	int offset=0;
 
-	vector<vector<FieldType>> pow_mult(prime_bitlen);
-	vector<FieldType> intermediate_mult(num_bins);
-	for(uint64_t i=0; i<prime_bitlen; i++) {
-		pow_mult[i].resize(num_bins);
+	vector<vector<FieldType>> slots(num_slots);
+	vector<FieldType> left, right;
+	for(int i=0; i<num_slots; i++) {
+		slots[i].resize(width);
 	}
 
-	for(uint64_t i=0; i< num_bins; i++) {
-		pow_mult[0][i] = a_vals[i]-this->N+1;
-	}
+	FieldType c = this->field->GetElement(this->N - 1);
+	batchSub(slots[0].data(), a_vals.data(), &c, width, 0);
 
-	for(uint64_t i=1; i<prime_bitlen; i++) {
-		this->DNHonestMultiplication(pow_mult[i-1], pow_mult[i-1], pow_mult[i], num_bins, offset);
-		offset = offset + num_bins * 2;
-	}
+	for(uint64_t r=0; r<mult_schedule.size(); r++) {
+		vector<MultStep> &steps = mult_schedule[r];
+		uint64_t num_mults = steps.size() * width;
+		left.resize(num_mults);
+		right.resize(num_mults);
+		for(uint64_t k=0; k<steps.size(); k++) {
+			copy(slots[steps[k].left].begin(), slots[steps[k].left].end(), left.begin() + k*width);
+			copy(slots[steps[k].right].begin(), slots[steps[k].right].end(), right.begin() + k*width);
+		}
 
-	for(uint64_t i=0; i<num_bins; i++) {
-		cpsi_outputs[i] = pow_mult[sindex[0]][i];
-	}
+		this->DNHonestMultiplication(left.data(), right.data(), left.data(), num_mults, offset);
+		offset = offset + num_mults * 2;
 
-	for(uint64_t i=1; i<sindex.size(); i++) {
-		this->DNHonestMultiplication(cpsi_outputs, pow_mult[sindex[i]], intermediate_mult, num_bins, offset);
-		offset = offset + num_bins*2;
-		for(uint64_t j=0; j<num_bins; j++) {
-			cpsi_outputs[j] = intermediate_mult[j];
+		for(uint64_t k=0; k<steps.size(); k++) {
+			copy(left.begin() + k*width, left.begin() + (k+1)*width, slots[steps[k].out].begin());
 		}
 	}
 
-	for(uint64_t j=0; j<num_bins; j++) {
-		cpsi_outputs[j] = *(this->field->GetOne()) - cpsi_outputs[j];
+	for(uint64_t j=0; j<width; j++) {
+		cpsi_outputs[j] = *(this->field->GetOne()) - slots[result_slot][j];
 	}
 }
 
@@ -553,20 +633,17 @@ template <class FieldType> void CircuitPSI<FieldType>::computeIntersectionShares
  */
 template <class FieldType> void CircuitPSI<FieldType>::leaderOpen() {
 	int fieldByteSize = this->field->getElementSizeInBytes();
-	vector<byte> multbytes(num_bins * fieldByteSize);
+	vector<byte> multbytes(width * fieldByteSize);
 	vector<vector<byte>> recBufsBytes;
 	int i;
-	uint64_t j;
 
 	//Convert shares to bytes
-	for(j=0; j < num_bins; j++) {
-		this->field->elementToBytes(multbytes.data() + (j*fieldByteSize), cpsi_outputs[j]);
-	}
+	elementsToBytes(this->field, multbytes.data(), cpsi_outputs.data(), width);
 
 	if(this->m_partyId == 0) { //receive from other parties
 		recBufsBytes.resize(this->N);
 		for(i=0; i<this->N; i++) {
-			recBufsBytes[i].resize(num_bins * fieldByteSize);
+			recBufsBytes[i].resize(width * fieldByteSize);
 		}
 		this->roundFunctionSyncForP1(multbytes, recBufsBytes);
 	}
@@ -575,12 +652,11 @@ template <class FieldType> void CircuitPSI<FieldType>::leaderOpen() {
 	}
 
 	if(this->m_partyId == 0) { // Leader reconstructs shares
-		vector<FieldType> x1(this->N);
-		for(j=0; j<num_bins; j++) {
-			for(i=0; i<this->N; i++) {
-				x1[i] = this->field->bytesToElement(recBufsBytes[i].data() + (j*fieldByteSize));
-			}
-			outputs[j] = this->interpolate(x1);
+		if(this->packFactor > 1) {
+			this->packedOpenBatch(recBufsBytes, width, outputs.data());
+		}
+		else {
+			this->openBatch(recBufsBytes, width, outputs.data());
 		}
 		for(int j=0; j<10; j++) {
 			if(mpsi_print == true) {
@@ -0,0 +1,148 @@
+#ifndef MPCHONESTMAJORITY_EXCHANGEENGINE_H
+#define MPCHONESTMAJORITY_EXCHANGEENGINE_H
+
+#include <libscapi/include/comm/MPCCommunication.hpp>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+
+using namespace std;
+
+/**
+ * Persistent I/O threads for the libscapi channels of a party, created once with the party instead of
+ * spawning threads in every round. Each peer has a writer and a reader thread, so every link is used in both
+ * directions at once and a slow peer never holds up the others. A round submits its buffers with write()
+ * and read() and then waits for all of them with wait(). The transfers on one channel and direction
+ * run in the order they were submitted. An exception thrown by a channel is rethrown by wait().
+ * The buffers must stay valid until wait() returns.
+ */
+class ExchangeEngine {
+
+private:
+    struct Task {
+        byte *data;
+        size_t size;
+    };
+
+    struct Worker {
+        shared_ptr<CommParty> channel;
+        bool isWriter;
+        deque<Task> tasks;
+        bool stopping = false;//guarded by lock, like tasks
+        mutex lock;
+        condition_variable ready;
+        thread t;
+    };
+
+    vector<unique_ptr<Worker>> writers;//by index in parties
+    vector<unique_ptr<Worker>> readers;
+
+    mutex doneLock;
+    condition_variable done;
+    uint64_t pending = 0;
+    exception_ptr error;
+
+    void run(Worker *w) {
+        while (true) {
+            Task task;
+            {
+                unique_lock<mutex> guard(w->lock);
+                w->ready.wait(guard, [&]() { return w->stopping || !w->tasks.empty(); });
+                if (w->tasks.empty()) {
+                    return;
+                }
+                task = w->tasks.front();
+                w->tasks.pop_front();
+            }
+
+            try {
+                if (w->isWriter) {
+                    w->channel->write(task.data, task.size);
+                } else {
+                    w->channel->read(task.data, task.size);
+                }
+            } catch (...) {
+                lock_guard<mutex> guard(doneLock);
+                if (!error) {
+                    error = current_exception();
+                }
+            }
+
+            lock_guard<mutex> guard(doneLock);
+            if (--pending == 0) {
+                done.notify_all();
+            }
+        }
+    }
+
+    void submit(Worker *w, byte *data, size_t size) {
+        {
+            lock_guard<mutex> guard(doneLock);
+            pending++;
+        }
+        {
+            lock_guard<mutex> guard(w->lock);
+            w->tasks.push_back({data, size});
+        }
+        w->ready.notify_one();
+    }
+
+    Worker *start(shared_ptr<CommParty> channel, bool isWriter) {
+        Worker *w = new Worker();
+        w->channel = channel;
+        w->isWriter = isWriter;
+        w->t = thread(&ExchangeEngine::run, this, w);
+        return w;
+    }
+
+public:
+    explicit ExchangeEngine(vector<shared_ptr<ProtocolPartyData>> &parties) {
+        for (size_t i = 0; i < parties.size(); i++) {
+            writers.emplace_back(start(parties[i]->getChannel(), true));
+            readers.emplace_back(start(parties[i]->getChannel(), false));
+        }
+    }
+
+    ~ExchangeEngine() {
+        vector<Worker *> all;
+        for (size_t i = 0; i < writers.size(); i++) {
+            all.push_back(writers[i].get());
+            all.push_back(readers[i].get());
+        }
+        for (Worker *w : all) {
+            lock_guard<mutex> guard(w->lock);
+            w->stopping = true;
+        }
+        for (Worker *w : all) {
+            w->ready.notify_one();
+            w->t.join();
+        }
+    }
+
+    //send size bytes to parties[peer]
+    void write(int peer, const byte *data, size_t size) {
+        submit(writers[peer].get(), const_cast<byte *>(data), size);
+    }
+
+    //receive size bytes from parties[peer]
+    void read(int peer, byte *data, size_t size) {
+        submit(readers[peer].get(), data, size);
+    }
+
+    //block until all transfers submitted so far are done
+    void wait() {
+        unique_lock<mutex> guard(doneLock);
+        done.wait(guard, [&]() { return pending == 0; });
+        if (error) {
+            exception_ptr e = error;
+            error = nullptr;
+            rethrow_exception(e);
+        }
+    }
+};
+
+#endif //MPCHONESTMAJORITY_EXCHANGEENGINE_H
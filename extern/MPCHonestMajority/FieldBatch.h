@@ -0,0 +1,50 @@
+#ifndef MPCHONESTMAJORITY_FIELDBATCH_H
+#define MPCHONESTMAJORITY_FIELDBATCH_H
+
+#include <cstdint>
+
+/**
+ * Elementwise arithmetic over arrays of field elements, used by the hot loops of the protocols.
+ * The second operand is read as b[k*bStep]: bStep 1 is a plain array, 2 picks one half of an interleaved
+ * pair array (e.g. randomTAnd2TShares) and 0 broadcasts a single element.
+ * out may alias a; it may alias b only when bStep is 1.
+ *
+ * These are the generic versions. A field can provide more specialized overloads with the same names and
+ * parameters (see ZpMersenneByteElement.h), which are picked up at instantiation and are preferred over these.
+ */
+
+template <class FieldType>
+void batchAdd(FieldType *out, const FieldType *a, const FieldType *b, uint64_t n, int bStep = 1) {
+    for (uint64_t k = 0; k < n; k++) {
+        FieldType x = a[k];//the field operators are not const
+        out[k] = x + b[k*bStep];
+    }
+}
+
+template <class FieldType>
+void batchSub(FieldType *out, const FieldType *a, const FieldType *b, uint64_t n, int bStep = 1) {
+    for (uint64_t k = 0; k < n; k++) {
+        FieldType x = a[k];
+        out[k] = x - b[k*bStep];
+    }
+}
+
+template <class FieldType>
+void batchMul(FieldType *out, const FieldType *a, const FieldType *b, uint64_t n, int bStep = 1) {
+    for (uint64_t k = 0; k < n; k++) {
+        FieldType x = a[k];
+        out[k] = x * b[k*bStep];
+    }
+}
+
+//out = a*b - c, with c read as c[k*cStep]
+template <class FieldType>
+void batchMulSub(FieldType *out, const FieldType *a, const FieldType *b, const FieldType *c, uint64_t n, int cStep = 1) {
+    for (uint64_t k = 0; k < n; k++) {
+        FieldType x = a[k];
+        FieldType prod = x * b[k];
+        out[k] = prod - c[k*cStep];
+    }
+}
+
+#endif //MPCHONESTMAJORITY_FIELDBATCH_H
@@ -0,0 +1,69 @@
+#ifndef MPCHONESTMAJORITY_FIELDBYTES_H
+#define MPCHONESTMAJORITY_FIELDBYTES_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * Conversion of arrays of field elements to and from the byte buffers sent over the channels, used by the
+ * hot loops of the protocols instead of calling elementToBytes/bytesToElement once per element.
+ * Element k is at out + k*getElementSizeInBytes(), as with the per-element calls.
+ *
+ * A field whose elements are stored exactly as they are sent (a trivially copyable object of
+ * getElementSizeInBytes() bytes, copied as is by elementToBytes) declares it by specializing FieldIsWireFormat,
+ * and the conversion is then a single memcpy. The other fields are converted element by element.
+ */
+
+template <class FieldType>
+struct FieldIsWireFormat : std::false_type {};
+
+//8 byte elements, the value in an unsigned long (libscapi)
+class ZpMersenneLongElement;
+template <>
+struct FieldIsWireFormat<ZpMersenneLongElement> : std::true_type {};
+
+namespace fieldbytes {
+
+template <class FieldType, class Field>
+inline void toBytes(Field *field, uint8_t *out, const FieldType *in, uint64_t n, std::true_type) {
+    memcpy(out, in, n * sizeof(FieldType));
+}
+
+template <class FieldType, class Field>
+inline void toBytes(Field *field, uint8_t *out, const FieldType *in, uint64_t n, std::false_type) {
+    int fieldByteSize = field->getElementSizeInBytes();
+    for (uint64_t k = 0; k < n; k++) {
+        FieldType x = in[k];//elementToBytes takes a non const reference
+        field->elementToBytes(out + k*fieldByteSize, x);
+    }
+}
+
+template <class FieldType, class Field>
+inline void fromBytes(Field *field, FieldType *out, const uint8_t *in, uint64_t n, std::true_type) {
+    memcpy(out, in, n * sizeof(FieldType));
+}
+
+template <class FieldType, class Field>
+inline void fromBytes(Field *field, FieldType *out, const uint8_t *in, uint64_t n, std::false_type) {
+    int fieldByteSize = field->getElementSizeInBytes();
+    for (uint64_t k = 0; k < n; k++) {
+        out[k] = field->bytesToElement(const_cast<uint8_t *>(in) + k*fieldByteSize);
+    }
+}
+
+}
+
+//writes the n elements of in to out
+template <class FieldType, class Field>
+void elementsToBytes(Field *field, uint8_t *out, const FieldType *in, uint64_t n) {
+    fieldbytes::toBytes(field, out, in, n, FieldIsWireFormat<FieldType>());
+}
+
+//reads n elements from in to out
+template <class FieldType, class Field>
+void bytesToElements(Field *field, FieldType *out, const uint8_t *in, uint64_t n) {
+    fieldbytes::fromBytes(field, out, in, n, FieldIsWireFormat<FieldType>());
+}
+
+#endif //MPCHONESTMAJORITY_FIELDBYTES_H
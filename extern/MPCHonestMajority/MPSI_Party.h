@@ -42,8 +42,7 @@ class MPSI_Party : public ProtocolParty<FieldType>{
 		 *
 		 * Methods:
 		 * Constructor
-		 * roundFunctionSync, exchangeData, roundFunctionSyncBroadcast, recData, roundFunctionSyncForP1,
-		 *   recDataToP1, sendDataToP1, sendFromP1
+		 * roundFunctionSync, roundFunctionSyncBroadcast, roundFunctionSyncForP1, sendFromP1, scatterFromP1
 		 * run, runOffline, runOnline
 		 * readMyInputs
 		 * initialisationPhase
@@ -62,6 +61,7 @@ class MPSI_Party : public ProtocolParty<FieldType>{
 		 */
 
 		uint64_t num_bins; // number of bins
+		uint64_t width; //shared values per vector of bins: num_bins, or the number of packs with packed sharing
 		uint64_t sent_bytes, recv_bytes; // communication
 		vector<FieldType> masks; //the shares of the masks s_j for each value to be multiplied with
 		vector<FieldType> add_a; //additive shares of a_j
@@ -69,6 +69,7 @@ class MPSI_Party : public ProtocolParty<FieldType>{
 		vector<FieldType> mult_outs; //threshold shares of s_j*a_j
 		vector<FieldType> outputs; //the shares of s_j*a_j
 		vector<FieldType> randomTAndAddShares; //shares of r_j for conversion of inputs to T-sharings
+		string conversionType; //additive-to-threshold conversion: Leader (open at P0 and reshare) or Direct (every party shares)
 
 		MPSI_Party(int argc, char* argv[]);
 
@@ -78,9 +79,15 @@ class MPSI_Party : public ProtocolParty<FieldType>{
 		//convert shares to field for testing purposes
 		void convertSharestoFieldType(vector<uint64_t>& bins, vector<FieldType>& shares, uint64_t nbins);
 
-		//perform MPSI
+		//perform MPSI (offline followed by online)
 		uint64_t runMPSI();
 
+		//input-independent preprocessing for nbins bins; may run while the OPPRF phase is in progress
+		void runMPSIOffline(uint64_t nbins);
+
+		//evaluate the circuit on the inputs read by readMPSIInputs using the preprocessed randomness
+		uint64_t runMPSIOnline();
+
 		//prepare additive and T-threshold sharings of secret random value r_j using DN07's protocol
 		void modDoubleRandom(uint64_t no_random, vector<FieldType>& randomElementsToFill);
 
@@ -123,6 +130,8 @@ template <class FieldType> MPSI_Party<FieldType>::MPSI_Party(int argc, char* arg
 	//cout << this->m_partyId << ": Entered constructor." << endl;
         CmdParser parser = this->getParser();
 
+	conversionType = parser.getValueByKey(this->arguments, "conversionType");
+
 	sent_bytes = 0;
 	recv_bytes = 0;
 
@@ -190,12 +199,20 @@ template <class FieldType> void MPSI_Party<FieldType>::convertSharestoFieldType(
  * perform MPSI
  */
 template <class FieldType> uint64_t MPSI_Party<FieldType>::runMPSI() {
-        masks.resize(num_bins);
-        a_vals.resize(num_bins);
-        mult_outs.resize(num_bins);
-        outputs.resize(num_bins);
+	runMPSIOffline(num_bins);
+	return runMPSIOnline();
+}
 
-	uint64_t counter = 0;
+/*
+ * Generate the input-independent shared randomness for nbins bins
+ */
+template <class FieldType> void MPSI_Party<FieldType>::runMPSIOffline(uint64_t nbins) {
+	num_bins = nbins;
+	width = this->numPacks(num_bins);
+        masks.resize(width);
+        a_vals.resize(width);
+        mult_outs.resize(width);
+        outputs.resize(width * this->packFactor);
 
 	auto t1 = high_resolution_clock::now();
         this->honestMult->invokeOffline();
@@ -203,26 +220,40 @@ template <class FieldType> uint64_t MPSI_Party<FieldType>::runMPSI() {
 	auto dur1 = duration_cast<milliseconds>(t2-t1).count();
 	//cout << this->m_partyId << ": Time to initialise matrices is: " << dur1 << " milliseconds." << endl;
 
-	//Generate random T-sharings
+	//Generate random T-sharings, additive and T-sharings and T and 2T sharings for multiplication
         auto t3 = high_resolution_clock::now();
-        this->generateRandomShares(num_bins, masks);
+        if(this->packFactor > 1) {
+                //random T-sharings are random packed sharings, the multiplication needs packed double sharings
+                if(this->genRandomSharesType == "PRSS") {
+                        this->generateRandomSharesPRSS(width, masks);
+                }
+                else {
+                        this->generateRandomShares(width, masks);
+                }
+                this->generatePackedDoubleShares(width, this->randomTAnd2TShares);
+        }
+        else if(this->genRandomSharesType == "PRSS") {
+                this->generateRandomSharesPRSS(num_bins, masks);
+                if(conversionType != "Direct") {
+                        modDoubleRandom(num_bins, randomTAndAddShares);
+                }
+                this->generateRandom2TAndTSharesPRSS(num_bins, this->randomTAnd2TShares);
+        }
+        else {
+                //all three kinds are dealt in one round, sized by the number of multiplications of the circuit
+                this->generateFusedShares(num_bins, conversionType != "Direct" ? num_bins : 0, num_bins,
+                                masks, randomTAndAddShares, this->randomTAnd2TShares);
+        }
         auto t4 = high_resolution_clock::now();
         auto dur2 = duration_cast<milliseconds>(t4-t3).count();
-        //cout << this->m_partyId << ": T-sharings generated in " << dur3 << "milliseconds." << endl;
-
-        //Generate random additive and T-sharings
-	auto t5 = high_resolution_clock::now();
-        modDoubleRandom(num_bins, randomTAndAddShares);
-	auto t6 = high_resolution_clock::now();
-	auto dur3 = duration_cast<milliseconds>(t6-t5).count();
-	//cout << this->m_partyId << ": T- and additive sharings generated in " << dur2 << " milliseconds." << endl;
-
-        //Generate random T and 2T sharings for multiplication
-	auto t7 = high_resolution_clock::now();
-        this->generateRandom2TAndTShares(num_bins, this->randomTAnd2TShares);
-	auto t8 = high_resolution_clock::now();
-	auto dur4 = duration_cast<milliseconds>(t8-t7).count();
-	//cout << this->m_partyId << ": T- and 2T-sharings generated in " << dur4 << " milliseconds." << endl;
+        //cout << this->m_partyId << ": random sharings generated in " << dur2 << " milliseconds." << endl;
+}
+
+/*
+ * Evaluate the circuit on the inputs; runMPSIOffline must have completed
+ */
+template <class FieldType> uint64_t MPSI_Party<FieldType>::runMPSIOnline() {
+	uint64_t counter = 0;
 
         //Evaluate the circuit
         evaluateCircuit();
@@ -246,12 +277,14 @@ template <class FieldType> uint64_t MPSI_Party<FieldType>::runMPSI() {
  */
 template <class FieldType> void MPSI_Party<FieldType>::modDoubleRandom(uint64_t no_random, vector<FieldType>& randomElementsToFill) {
 	//cout << this->m_partyId <<  ": Generating double sharings..." << endl;
-        int index = 0;
+        if(this->genRandomSharesType == "PRSS") {
+                //derived locally from the PRSS subset keys, no communication
+                this->generateRandomTAndAddSharesPRSS(no_random, randomElementsToFill);
+                return;
+        }
         int N = this->N;
         int T = this->T;
 
-        vector<FieldType> x1(N), y1(N), y2(N), t1(N), r1(N), t2(N), r2(N);
-
         vector<vector<FieldType>> sendBufsElements(N);
 
         vector<vector<byte>> sendBufsBytes(N);
@@ -278,58 +311,53 @@ template <class FieldType> void MPSI_Party<FieldType>::modDoubleRandom(uint64_t
          *  first degree T, then additive
          *
          */
+        //the shares of the T parties after me are expanded from seeds, at 2k for degree T and 2k+1 for additive
+        vector<vector<byte>> seeds;
+        vector<vector<FieldType>> seededShares;
+        this->beginSeededDealing(no_buckets*2, seeds, seededShares);
+
+        // random field elements, uniform distribution,
+        // the secret and the seeded shares fix each degree-T polynomial
+        vector<FieldType> secrets(no_buckets);
         for(uint64_t k=0; k < no_buckets; k++) {
-                // generate random degree-T polynomial
-                for(int i = 0; i < T+1; i++) {
-                        // A random field element, uniform distribution,
-                        // note that x1[0] is the secret which is also random
-                        x1[i] = this->field->Random();
-                }
-
-                this->matrix_vand.MatrixMult(x1, y1,T+1); // eval poly at alpha-positions
+                secrets[k] = this->field->Random();
+        }
 
-                y2[0] = x1[0];
-                // generate N-1 random elements
-                for(int i = 1; i < N; i++) {
-                        // A random field element, uniform distribution
-                        y2[i] = this->field->Random();
-                        //all y2[i] generated so far are additive shares of the secret x1[0]
-                        y2[0] = y2[0] - y2[i];
-                }
-		//testShareGenNoComm(y1, y2);
+        this->seededSharings(secrets.data(), T, seededShares, 0, 2, no_buckets, sendBufsElements);
 
-                // prepare shares to be sent
-                for(int i=0; i < N; i++) {
-                        //cout << "y1[ " <<i<< "]" <<y1[i] << " y2[ " << i << "]" << y2[i] << endl;
-                        sendBufsElements[i][2*k] = y1[i];
-                        sendBufsElements[i][2*k + 1] = y2[i];
+        for(uint64_t k=0; k < no_buckets; k++) {
+                FieldType mine = secrets[k];
+                // generate N-1 random elements, the seeded parties expand theirs
+                for(int i = 0; i < N; i++) {
+                        if(i == this->m_partyId) {
+                                continue;
+                        }
+                        if(this->isSeeded(this->m_partyId, i)) {
+                                sendBufsElements[i][2*k + 1] = seededShares[i][2*k + 1];
+                        }
+                        else {
+                                // A random field element, uniform distribution
+                                sendBufsElements[i][2*k + 1] = this->field->Random();
+                        }
+                        //all shares generated so far are additive shares of the secret
+                        mine = mine - sendBufsElements[i][2*k + 1];
                 }
-
+                sendBufsElements[this->m_partyId][2*k + 1] = mine;
         }
 
         for(int i=0; i < N; i++) {
-                for(uint64_t j=0; j<sendBufsElements[i].size();j++) {
-                        this->field->elementToBytes(sendBufsBytes[i].data() + (j * fieldByteSize), sendBufsElements[i][j]);
-                }
+                elementsToBytes(this->field, sendBufsBytes[i].data(), sendBufsElements[i].data(), sendBufsElements[i].size());
         }
 
+        //seeded parties get their seed instead of their shares
+        this->compressSeededShares(sendBufsBytes, seeds);
+        this->resizeSeededReceive(recBufsBytes);
+
         this->roundFunctionSync(sendBufsBytes, recBufsBytes, 1);
 
-        for(uint64_t k=0; k < no_buckets; k++) {
-                for (int i = 0; i < N; i++) {
-                        t1[i] = this->field->bytesToElement(recBufsBytes[i].data() + (2*k * fieldByteSize));
-                        t2[i] = this->field->bytesToElement(recBufsBytes[i].data() + ((2*k +1) * fieldByteSize));
-                }
-                this->matrix_vand_transpose.MatrixMult(t1, r1,N-T);
-                this->matrix_vand_transpose.MatrixMult(t2, r2,N-T);
-
-                //copy the resulting vector to the array of randoms
-                for (int i = 0; i < (N - T); i++) {
-                        randomElementsToFill[index*2] = r1[i];
-                        randomElementsToFill[index*2 +1] = r2[i];
-                        index++;
-                }
-        }
+        this->expandSeededShares(recBufsBytes, no_buckets*2);
+
+        this->extractRandomShares(recBufsBytes, 0, no_buckets, 2, randomElementsToFill);
 
         if (mpsi_print == true) {
                 cout << this->m_partyId << ": First pair of shares is " << randomElementsToFill[0] << " " << randomElementsToFill[1] << endl;
@@ -350,14 +378,11 @@ template <class FieldType> void MPSI_Party<FieldType>::addShareOpen(uint64_t num
 	vector<byte> sendBufsBytes;
 	vector<byte> aPlusRSharesBytes(num_vals*fieldByteSize);
 	int i;
-	uint64_t j;
 	int N = this->N;
 
 	secrets.resize(num_vals);
 
-	for(j=0; j<num_vals; j++) {
-		this->field->elementToBytes(aPlusRSharesBytes.data() + (j * fieldByteSize), shares[j]);
-	}
+	elementsToBytes(this->field, aPlusRSharesBytes.data(), shares.data(), num_vals);
 
 	if(this->m_partyId == 0) {
 		recBufsBytes.resize(N);
@@ -381,11 +406,11 @@ template <class FieldType> void MPSI_Party<FieldType>::addShareOpen(uint64_t num
 	//reconstruct the shares recieved from the other parties
 	if (this->m_partyId == 0) {
 
-		for (j = 0; j < num_vals; j++) {
-			secrets[j] = *(this->field->GetZero());
-			for (i = 0; i < N; i++) {
-                		secrets[j] += this->field->bytesToElement(recBufsBytes[i].data() + (j * fieldByteSize));
-           		 }
+		secrets.assign(num_vals, *(this->field->GetZero()));
+		vector<FieldType> received(num_vals);
+		for (i = 0; i < N; i++) {
+			bytesToElements(this->field, received.data(), recBufsBytes[i].data(), num_vals);
+			batchAdd(secrets.data(), secrets.data(), received.data(), num_vals);
 		}
 	}
 }
@@ -398,68 +423,50 @@ template <class FieldType> void MPSI_Party<FieldType>::reshare(vector<FieldType>
         int T = this->T;
         uint64_t no_vals = vals.size();
 
-        vector<FieldType> x1(N), y1(N);
-
         vector<vector<FieldType>> sendBufsElements(N);
         vector<vector<byte>> sendBufsBytes(N);
-	vector<vector<byte>> recBufsBytes(N);
-	vector<vector<FieldType>> recBufsElements(N);
 
         int fieldByteSize = this->field->getElementSizeInBytes();
 
         if(this->m_partyId == 0) {
-                //generate T-sharings of the values in vals
-                for(uint64_t k = 0; k < no_vals; k++) {
-                        //set x1[0] as the secret to be shared
-                        x1[0] = vals[k];
-                        // generate random degree-T polynomial
-                        for(int i = 1; i < T+1; i++) {
-                                // A random field element, uniform distribution
-                                x1[i] = this->field->Random();
-                        }
-
-                        this->matrix_vand.MatrixMult(x1, y1,T+1); // eval poly at alpha-positions
+                //the T parties after the leader expand their shares from a seed
+                vector<vector<byte>> seeds;
+                vector<vector<FieldType>> seededShares;
+                this->beginSeededDealing(no_vals, seeds, seededShares);
 
-                        // prepare shares to be sent
-                        for(int i=0; i < N; i++) {
-                                //cout << "y1[ " <<i<< "]" <<y1[i] << endl;
-                                sendBufsElements[i].push_back(y1[i]);
+                //generate T-sharings of the values in vals, the secret and the seeded shares fix each polynomial
+                for(int i=0; i < N; i++) {
+                        sendBufsElements[i].resize(no_vals);
+                }
+                this->seededSharings(vals.data(), T, seededShares, 0, 1, no_vals, sendBufsElements);
+                for(uint64_t k = 0; k < no_vals; k++) {
+                        shares[k] = sendBufsElements[0][k];
+                }
+                for(int i=0; i < N; i++) {
+                        if(this->isSeeded(0, i)) {
+                                sendBufsElements[i].clear();
                         }
-
-                        shares[k] = y1[0];
                 }
 
-		//cout << "Sharings generated " << endl;
-
 		for (int i=0; i<N; i++) {
 			sendBufsBytes[i].resize(sendBufsElements[i].size() * fieldByteSize);
-			recBufsBytes[i].resize(num_bins * fieldByteSize);
-			for(uint64_t j=0; j<sendBufsElements[i].size(); j++) {
-				this->field->elementToBytes(sendBufsBytes[i].data() + (j * fieldByteSize), sendBufsElements[i][j]);
-			}
-			//cout << sendBufsElements[i].size() << " " << sendBufsBytes[i].size() << " " << recBufsBytes[i].size();
+			elementsToBytes(this->field, sendBufsBytes[i].data(), sendBufsElements[i].data(), sendBufsElements[i].size());
 		}
-	}
-	else {
-		for (int i=0; i<N; i++) {
-			sendBufsBytes[i].resize(num_bins * fieldByteSize);
-			recBufsBytes[i].resize(num_bins * fieldByteSize);
-			for (uint64_t j=0; j<num_bins; j++) {
-				this->field->elementToBytes(sendBufsBytes[i].data(), *(this->field->GetZero()));
-			}
-		}
-	}
-
-	//cout << "byte conversion done " << endl;
 
-        this->roundFunctionSync(sendBufsBytes, recBufsBytes, 2);
+		this->compressSeededShares(sendBufsBytes, seeds);
 
-	//cout << "roundFunctionSync() done ";
-
-	if (this->m_partyId != 0) {
-		for(uint64_t k=0; k < no_vals; k++) {
-                	shares[k] = this->field->bytesToElement(recBufsBytes[0].data() + (k * fieldByteSize));
-        	}
+		//only the leader has data: each party receives its shares, nothing is sent back
+		this->scatterFromP1(sendBufsBytes);
+	}
+	else if(this->isSeeded(0, this->m_partyId)) {
+		vector<byte> seed(16);
+		this->parties[0]->getChannel()->read(seed.data(), seed.size());
+		this->expandSeed(seed.data(), no_vals, shares);
+	}
+	else {
+		vector<byte> recBytes(no_vals * fieldByteSize);
+		this->parties[0]->getChannel()->read(recBytes.data(), recBytes.size());
+		bytesToElements(this->field, shares.data(), recBytes.data(), no_vals);
 	}
 	//cout << "converted back to field elements..." << endl;
 
@@ -479,6 +486,17 @@ template <class FieldType> void MPSI_Party<FieldType>::reshare(vector<FieldType>
  * to get the T-threshold shares of the original secret
  */
 template <class FieldType> void MPSI_Party<FieldType>::additiveToThreshold() {
+	if(this->packFactor > 1) {
+		//every party packs and T-shares its own additive shares, as in the Direct conversion
+		this->packSharings(add_a, a_vals);
+		return;
+	}
+	if(conversionType == "Direct") {
+		//every party T-shares its own additive share, the T-sharings are added locally
+		this->sumSharings(add_a, a_vals);
+		return;
+	}
+
         uint64_t j;
 	vector<FieldType> reconar; // reconstructed aj+rj
         reconar.resize(num_bins);
@@ -488,11 +506,17 @@ template <class FieldType> void MPSI_Party<FieldType>::additiveToThreshold() {
                 add_a[j] = add_a[j] + randomTAndAddShares[j*2+1];
         }
 
-        //reconstruct additive shares, store in reconar
-        addShareOpen(num_bins, add_a, reconar);
+	if(this->kingRotation) {
+		//every party opens and reshares its own range of bins
+		this->kingAdditiveToThreshold(add_a.data(), num_bins, a_vals.data());
+	}
+	else {
+		//reconstruct additive shares, store in reconar
+		addShareOpen(num_bins, add_a, reconar);
 
-        //reshare and save in a_vals;
-        reshare(reconar, a_vals);
+		//reshare and save in a_vals;
+		reshare(reconar, a_vals);
+	}
 
 	//subtract T-threshold shares of rj
         for(j=0; j<num_bins; j++) {
@@ -508,20 +532,17 @@ template <class FieldType> void MPSI_Party<FieldType>::additiveToThreshold() {
  */
 template <class FieldType> void MPSI_Party<FieldType>::mult_sj() {
 	int fieldByteSize = this->field->getElementSizeInBytes();
-	vector<byte> multbytes(num_bins * fieldByteSize);
+	vector<byte> multbytes(width * fieldByteSize);
 	vector<vector<byte>> recBufsBytes;
 	int i;
-	uint64_t j;
 
-	this->DNHonestMultiplication(masks, a_vals, mult_outs, num_bins, 0);
-	for(j=0; j < num_bins; j++) {
-		this->field->elementToBytes(multbytes.data() + (j*fieldByteSize), mult_outs[j]);
-	}
+	this->DNHonestMultiplication(masks.data(), a_vals.data(), mult_outs.data(), width, 0);
+	elementsToBytes(this->field, multbytes.data(), mult_outs.data(), width);
 
 	if(this->m_partyId == 0) {
 		recBufsBytes.resize(this->N);
 		for(i=0; i<this->N; i++) {
-			recBufsBytes[i].resize(num_bins * fieldByteSize);
+			recBufsBytes[i].resize(width * fieldByteSize);
 		}
 		this->roundFunctionSyncForP1(multbytes, recBufsBytes);
 	}
@@ -530,12 +551,11 @@ template <class FieldType> void MPSI_Party<FieldType>::mult_sj() {
 	}
 
 	if(this->m_partyId == 0) {
-		vector<FieldType> x1(this->N);
-		for(j=0; j<num_bins; j++) {
-			for(i=0; i<this->N; i++) {
-				x1[i] = this->field->bytesToElement(recBufsBytes[i].data() + (j*fieldByteSize));
-			}
-			outputs[j] = this->interpolate(x1);
+		if(this->packFactor > 1) {
+			this->packedOpenBatch(recBufsBytes, width, outputs.data());
+		}
+		else {
+			this->openBatch(recBufsBytes, width, outputs.data());
 		}
 	}
 }
@@ -6,6 +6,10 @@
 #include <libscapi/include/primitives/Matrix.hpp>
 #include "GRRHonestMult.h"
 #include "DNHonestMult.h"
+#include "BatchMatrix.h"
+#include "FieldBatch.h"
+#include "FieldBytes.h"
+#include "ExchangeEngine.h"
 #include <libscapi/include/circuits/ArithmeticCircuit.hpp>
 #include <vector>
 #include <bitset>
@@ -21,12 +25,17 @@
 #include <libscapi/include/infra/Measurement.hpp>
 #include<emmintrin.h>
 #include <thread>
+#include <algorithm>
+#include <stdexcept>
 
 #define flag_print false
 #define flag_print_timings true
 #define flag_print_output true
 
 #define MAX_PRSS_PARTIES 16
+#define PRSS_BATCH (1 << 16) //elements drawn from a subset key per AES call
+#define OPEN_BLOCK 1024 //outputs reconstructed together, each party's shares of a block are read in one pass
+#define OPEN_MIN_PER_THREAD (1 << 14) //below this many outputs per thread the leader opens on one thread
 
 
 using namespace std;
@@ -41,6 +50,7 @@ public:
     vector<FieldType> firstRowVandInverse;
     TemplateField<FieldType> *field;
     vector<shared_ptr<ProtocolPartyData>>  parties;
+    ExchangeEngine *exchange = nullptr;//I/O threads of the round functions, one reader and one writer per peer
     //boost::asio::io_service io_service;
     vector<FieldType> randomTAnd2TShares;
 protected:
@@ -51,6 +61,8 @@ protected:
      */
 
     string genRandomSharesType, multType, verifyType;
+    bool kingRotation;//reconstruct-and-reshare by bin range at every party instead of at P0
+    int packFactor;//bins packed per sharing, 1 for plain Shamir sharing
     int currentCirciutLayer = 0;
 
     string s;
@@ -66,6 +78,7 @@ protected:
     HIM<FieldType> matrix_him;
 
     VDMTranspose<FieldType> matrix_vand_transpose;
+    BatchMatrix<FieldType> batch_vand_transpose;//the first N-T rows of matrix_vand_transpose, applied to all buckets at once
 
     HIM<FieldType> m;
 
@@ -74,6 +87,12 @@ protected:
     vector<FieldType> randomABShares;//a, b random shares
     vector<FieldType> c;//a vector of a*b shares
 
+    //scratch buffers of DNHonestMultiplication, kept across calls to avoid reallocating per layer
+    vector<byte> dnSendBytes;//my shares of xy-r
+    vector<byte> dnOpenBytes;//the opened xy-r
+    vector<vector<byte>> dnRecBufsBytes;//all shares of xy-r (P0 only, or the king of each range under king rotation)
+    vector<FieldType> dnAllShares;//the shares of xy-r, then the opened xy-r
+
     //vector<FieldType> randomTSharesOfflineMult;//a, b random shares
     //vector<FieldType> cOfflineMult;//a vector of a*b shares
 
@@ -101,16 +120,89 @@ public:
     ProtocolParty(int argc, char* argv[]);
 
 
+    /**
+     * The round functions hand their transfers to the party's ExchangeEngine, whose reader and writer
+     * threads per peer are started once in the constructor, and return when all of them are done.
+     * roundFunctionSync sends sendBufs[id] to and receives recBufs[id] from every party id, in both
+     * directions at once; roundFunctionSyncBroadcast sends the same message to everyone.
+     */
     void roundFunctionSync(vector<vector<byte>> &sendBufs, vector<vector<byte>> &recBufs, int round);
-    void exchangeData(vector<vector<byte>> &sendBufs,vector<vector<byte>> &recBufs, int first, int last);
     void roundFunctionSyncBroadcast(vector<byte> &message, vector<vector<byte>> &recBufs);
-    void recData(vector<byte> &message, vector<vector<byte>> &recBufs, int first, int last);
     void roundFunctionSyncForP1(vector<byte> &myShare, vector<vector<byte>> &recBufs);
-    void recDataToP1(vector<vector<byte>> &recBufs, int first, int last);
-
-    void sendDataFromP1(vector<byte> &sendBuf, int first, int last);
     void sendFromP1(vector<byte> &sendBuf);
 
+    //P0 sends sendBufs[id] to party id; the other parties only read from parties[0], nobody sends back
+    void scatterFromP1(vector<vector<byte>> &sendBufs);
+
+    /**
+     * King rotation (kingType Rotate). Instead of P0 reconstructing every value of a DN multiplication or of an
+     * intermediate opening, the values are split into N consecutive ranges and party k is the king of range k:
+     * it receives the shares of its range, reconstructs them and sends the result (or a resharing of it) back.
+     * Every party then sends and receives about the same amount of data. The final output opening is not rotated.
+     *
+     * kingFirst(k, count) is the first value of range k, range k ends at kingFirst(k + 1, count).
+     * kingGather sends range k of my shares to party k; recBufsBytes[i] receives party i's shares of my range.
+     * kingOpen opens the count T-sharings in shareBytes to all parties, each king interpolating its range.
+     * kingAdditiveToThreshold turns count additive sharings into T-sharings: each king adds up its range and
+     * deals T-sharings of the sums, seed-compressed as in reshare().
+     */
+    uint64_t kingFirst(int king, uint64_t count);
+    void kingGather(vector<byte> &shareBytes, uint64_t count, vector<vector<byte>> &recBufsBytes);
+    void kingOpen(vector<byte> &shareBytes, uint64_t count, FieldType *secrets);
+    void kingAdditiveToThreshold(const FieldType *addShares, uint64_t count, FieldType *shares);
+
+    /**
+     * Packed (Franklin-Yung) sharing (packFactor k > 1). A degree-T polynomial holds k bins at the points
+     * packPoints = 0, -1, ..., -(k-1) instead of one bin at 0, so it only hides them from T-k+1 parties.
+     * The circuits work on numPacks(num_bins) packed sharings, k bins each, bin b in pack b/k at slot b%k;
+     * adding constants and sharings works slot by slot as before.
+     *
+     * packedSharings deals count packs of secrets[b*k + j] with the given degree (T or 2T): the secrets and
+     * random shares of the first degree+1-k parties fix each polynomial, the other shares are interpolated.
+     * packSharings packs and T-shares every party's vals in one round and adds them up, as sumSharings does.
+     * generatePackedDoubleShares generates pairs of a degree-T and a degree-2T packed sharing of the same k
+     * random values, with the layout of generateRandom2TAndTShares, for the multiplications.
+     * packedOpenToShares is the king step of a packed DN multiplication: the king of each pack interpolates
+     * the k values of xy-r from the degree-2T shares and returns to every party its share of the degree k-1
+     * polynomial through them, so each party receives one element per pack instead of k.
+     * packedOpenBatch is openBatch for count packs, it writes the count*k values.
+     */
+    void initPacking();
+    uint64_t numPacks(uint64_t count) { return (count + packFactor - 1) / packFactor; }
+    FieldType lagrangeCoef(vector<FieldType> &points, int j, FieldType x);
+    void packedSharings(FieldType *secrets, int degree, uint64_t count, vector<vector<FieldType>> &sendBufsElements, uint64_t pos, uint64_t step);
+    void packSharings(vector<FieldType>& vals, vector<FieldType>& packedSums);
+    void generatePackedDoubleShares(uint64_t numOfRandomPairs, vector<FieldType>& randomElementsToFill);
+    void packedReencode(vector<vector<byte>> &recBufsBytes, uint64_t count, vector<vector<byte>> &sendBufsBytes);
+    void packedOpenToShares(vector<byte> &shareBytes, uint64_t count, FieldType *shares);
+    void packedOpenBatch(vector<vector<byte>> &recBufsBytes, uint64_t count, FieldType *secrets);
+    vector<FieldType> packPoints;
+    BatchMatrix<FieldType> batch_pack[2];//packed dealing of degree T and 2T, from the fixed points to the others
+    vector<FieldType> packOpen;//k x N, the packed values from the N shares
+    vector<FieldType> packReencode;//N x N, the shares of the degree k-1 polynomial through the packed values
+
+    /**
+     * Seed-compressed dealing. When a party deals a sharing, the shares of the T parties that follow it
+     * (ids m+1..m+T mod N) are expanded from a 16-byte AES seed sent to each of them, instead of being sent
+     * explicitly. Together with the secret these T shares fix a degree-T polynomial, so the dealer interpolates
+     * the remaining N-T shares and sends only those. For a degree-2T sharing the next T shares are random and
+     * are sent explicitly as well.
+     * The buffers are dealt as usual; compressSeededShares/resizeSeededReceive shrink the seeded buffers to
+     * 16 bytes before the round and expandSeededShares restores them to full shares after it.
+     */
+    void initSeededDealing();
+    bool isSeeded(int dealer, int receiver);
+    void expandSeed(byte *seed, uint64_t count, vector<FieldType> &out);
+    void beginSeededDealing(uint64_t count, vector<vector<byte>> &seeds, vector<vector<FieldType>> &seededShares);
+    void seededSharings(FieldType *secrets, int degree, vector<vector<FieldType>> &seededShares, uint64_t pos, uint64_t step,
+                        uint64_t count, vector<vector<FieldType>> &sendBufsElements);
+    void compressSeededShares(vector<vector<byte>> &sendBufsBytes, vector<vector<byte>> &seeds);
+    void resizeSeededReceive(vector<vector<byte>> &recBufsBytes);
+    void expandSeededShares(vector<vector<byte>> &recBufsBytes, uint64_t count);
+    vector<int> seededKnown[2];//points fixed before interpolation (-1 is the secret), for degree T and 2T
+    vector<int> seededUnknown[2];//points interpolated by the dealer
+    BatchMatrix<FieldType> batch_seeded[2];//interpolation from the fixed points to the others
+
 
 
     void printSubSet( bitset<MAX_PRSS_PARTIES> &l);
@@ -224,7 +316,14 @@ public:
      */
     void GRRHonestMultiplication(FieldType *a, FieldType *b, vector<FieldType> &cToFill, int numOfTrupples);
 
-    void DNHonestMultiplication(vector<FieldType> a, vector<FieldType> b, vector<FieldType> &cToFill, uint64_t numOfTrupples, int offset);
+    void DNHonestMultiplication(const vector<FieldType> &a, const vector<FieldType> &b, vector<FieldType> &cToFill, uint64_t numOfTrupples, int offset);
+
+    /**
+     * Multiplies numOfTrupples pairs a[k]*b[k] into cToFill[k] using the double sharings starting at offset in
+     * randomTAnd2TShares. cToFill may alias a or b. Works on the party's scratch buffers, so repeated calls
+     * (one per layer) do not copy the operands or allocate.
+     */
+    void DNHonestMultiplication(const FieldType *a, const FieldType *b, FieldType *cToFill, uint64_t numOfTrupples, int offset);
 
     void offlineDNForMultiplication(int numOfTriples);
 
@@ -255,9 +354,44 @@ public:
 
     void generateRandomShares(uint64_t numOfRandoms, vector<FieldType>& randomElementsToFill);
     void setupPRSS();
-    void generateRandomSharesPRSS(int numOfRnadoms, vector<FieldType>& randomElementsToFill);
+    void generateRandomSharesPRSS(uint64_t numOfRnadoms, vector<FieldType>& randomElementsToFill);
     void generateRandom2TAndTShares(uint64_t numOfRandomPairs, vector<FieldType>& randomElementsToFill);
 
+    /**
+     * Non-interactive counterparts of generateRandom2TAndTShares and of the T/additive double sharings of the
+     * MPSI variants, from the PRSS subset keys. The T-sharing is the usual PRSS sharing sum_A r_A*f_A(alpha_i).
+     * The 2T-sharing adds a pseudo-random zero sharing sum_A f_A(alpha_i)*sum_l r_A,l*alpha_i^l (l = 1..T).
+     * The additive share is the Lagrange coefficient times the T-share, re-randomized by a zero sharing in
+     * which each subset member adds its own value of the subset and subtracts the next member's.
+     * Both fill pairs [2k], [2k+1] like their interactive versions.
+     */
+    void generateRandom2TAndTSharesPRSS(uint64_t numOfRandomPairs, vector<FieldType>& randomElementsToFill);
+    void generateRandomTAndAddSharesPRSS(uint64_t numOfRandomPairs, vector<FieldType>& randomElementsToFill);
+    void prssElements(int subset, uint64_t count, vector<FieldType>& out);
+
+    /**
+     * Every party T-shares each of its values and sends the shares to all parties in one round;
+     * sums[k] is then a T-sharing of the sum over all parties of vals[k].
+     */
+    void sumSharings(vector<FieldType>& vals, vector<FieldType>& sums);
+
+    /**
+     * Deals every kind of random sharing the MPSI circuits need in a single round: numT T-sharings,
+     * numTAndAdd pairs of T and additive sharings of the same secret and numTAnd2T pairs of T and 2T sharings.
+     * Each party deals the buckets of all three kinds in one buffer per receiver (T, then T/additive, then T/2T)
+     * and the outputs are extracted through matrix_vand_transpose per kind, with the layouts of
+     * generateRandomShares, modDoubleRandom and generateRandom2TAndTShares. A count of 0 skips that kind.
+     */
+    void generateFusedShares(uint64_t numT, uint64_t numTAndAdd, uint64_t numTAnd2T, vector<FieldType>& tShares,
+                             vector<FieldType>& tAndAddShares, vector<FieldType>& tAnd2TShares);
+
+    /**
+     * Applies batch_vand_transpose to the no_buckets buckets received in recBufsBytes, starting at element offset.
+     * A bucket holds lanes consecutive elements (lanes = 1 for T-sharings, 2 for pairs), and the outputs keep
+     * them interleaved, as generateRandomShares and generateRandom2TAndTShares return them.
+     */
+    void extractRandomShares(vector<vector<byte>> &recBufsBytes, uint64_t offset, uint64_t no_buckets, int lanes, vector<FieldType>& randomElementsToFill);
+
 
     /**
      * Check whether given points lie on polynomial of degree d.
@@ -317,6 +451,14 @@ public:
 
     FieldType tinterpolate(vector<FieldType> x);
 
+    /**
+     * The leader's batched counterpart of interpolate: secrets[k] is reconstructed from share k of every party
+     * in recBufsBytes as the dot product of firstRowVandInverse with those shares. The outputs are processed in
+     * blocks of OPEN_BLOCK, streaming each party's buffer over a block, and the blocks are split over threads.
+     */
+    void openBatch(vector<vector<byte>> &recBufsBytes, uint64_t count, FieldType *secrets);
+    void openBatchRange(vector<vector<byte>> &recBufsBytes, uint64_t first, uint64_t last, FieldType *secrets);
+
 
     /**
      * Walk through the circuit and verify the multiplication gates.
@@ -359,6 +501,10 @@ ProtocolParty<FieldType>::ProtocolParty(int argc, char* argv[]) : MPCProtocol("M
     this->multType = parser.getValueByKey(arguments, "multType");
     this->verifyType = parser.getValueByKey(arguments, "verifyType");
     this->times = stoi(parser.getValueByKey(arguments, "internalIterationsNumber"));
+    //optional, the openings stay at P0 unless Rotate is given
+    this->kingRotation = (parser.getValueByKey(arguments, "kingType") == "Rotate");
+    string packArg = parser.getValueByKey(arguments, "packFactor");
+    this->packFactor = (packArg == "NotFound") ? 1 : stoi(packArg);
     if(multType=="GRR"){
         honestMult = new GRRHonestMult<FieldType>(this);
     }
@@ -387,6 +533,8 @@ ProtocolParty<FieldType>::ProtocolParty(int argc, char* argv[]) : MPCProtocol("M
     } else if(fieldType.compare("ZpMersenneByte") == 0) {
         //std::cout <<"ZpMersenne Byte"<<std::endl;
         field = new TemplateField<FieldType>(0);
+    } else if(fieldType.compare("ZpMersenneShort") == 0) {
+        field = new TemplateField<FieldType>(0);
     }
     
 
@@ -415,6 +563,7 @@ ProtocolParty<FieldType>::ProtocolParty(int argc, char* argv[]) : MPCProtocol("M
     counter = 0;
     parties = MPCCommunication::setCommunication(io_service, m_partyId, N,
                 this->getParser().getValueByKey(arguments, "partiesFile"));
+    exchange = new ExchangeEngine(parties);
     //readMyInputs();
     auto t1 = high_resolution_clock::now();
     initializationPhase();
@@ -464,9 +613,7 @@ bool ProtocolParty<FieldType>::broadcast(int party_id, vector<byte> myMessage, v
     for(int i=0; i < N; i++)
     {
         recBufsElements[i].resize((recBufsdiffBytes[i].size()) / fieldByteSize);
-        for(int j=0; j<recBufsElements[i].size();j++) {
-            recBufsElements[i][j] = field->bytesToElement(recBufsdiffBytes[i].data() + ( j * fieldByteSize));
-        }
+        bytesToElements(field, recBufsElements[i].data(), recBufsdiffBytes[i].data(), recBufsElements[i].size());
     }
 
 
@@ -581,9 +728,7 @@ bool ProtocolParty<FieldType>::broadcast(int party_id, vector<byte> myMessage, v
     {
         sendBufsBytes[i].resize(no_buckets*fieldByteSize);
         recBufs2Bytes[i].resize(no_buckets*fieldByteSize);
-        for(int j=0; j<no_buckets;j++) {
-            field->elementToBytes(sendBufsBytes[i].data() + (j * fieldByteSize), sendBufsElements[i][j]);
-        }
+        elementsToBytes(field, sendBufsBytes[i].data(), sendBufsElements[i].data(), no_buckets);
     }
 
 
@@ -593,9 +738,7 @@ bool ProtocolParty<FieldType>::broadcast(int party_id, vector<byte> myMessage, v
     for(int i=0; i < N; i++)
     {
         recBufs2Elements[i].resize((recBufs2Bytes[i].size()) / fieldByteSize);
-        for(int j=0; j<recBufs2Elements[i].size();j++) {
-            recBufs2Elements[i][j] = field->bytesToElement(recBufs2Bytes[i].data() + ( j * fieldByteSize));
-        }
+        bytesToElements(field, recBufs2Elements[i].data(), recBufs2Bytes[i].data(), recBufs2Elements[i].size());
     }
 
 
@@ -840,9 +983,7 @@ void ProtocolParty<FieldType>::inputPhase()
         sendBufsBytes[i].resize(sendBufsElements[i].size()*fieldByteSize);
         //cout<< "size of sendBufs1Elements["<<i<<" ].size() is " << sendBufs1Elements[i].size() <<"myID =" <<  m_partyId<<endl;
         recBufBytes[i].resize(sizes[i]*fieldByteSize);
-        for(int j=0; j<sendBufsElements[i].size();j++) {
-            field->elementToBytes(sendBufsBytes[i].data() + (j * fieldByteSize), sendBufsElements[i][j]);
-        }
+        elementsToBytes(field, sendBufsBytes[i].data(), sendBufsElements[i].data(), sendBufsElements[i].size());
     }
 
 
@@ -853,9 +994,7 @@ void ProtocolParty<FieldType>::inputPhase()
     for(int i=0; i < N; i++)
     {
         recBufElements[i].resize((recBufBytes[i].size()) / fieldByteSize);
-        for(int j=0; j<recBufElements[i].size();j++) {
-            recBufElements[i][j] = field->bytesToElement(recBufBytes[i].data() + ( j * fieldByteSize));
-        }
+        bytesToElements(field, recBufElements[i].data(), recBufBytes[i].data(), recBufElements[i].size());
     }
 
 
@@ -949,6 +1088,10 @@ void ProtocolParty<FieldType>::setupPRSS() {
     if (flag_print) {
         cout << "in PRSS setup" << endl;
     }
+    if (N > MAX_PRSS_PARTIES) {
+        throw runtime_error("PRSS supports at most " + to_string(MAX_PRSS_PARTIES) + " parties");
+    }
+
     //generate all subsets that include my party id
     bitset<MAX_PRSS_PARTIES> lt;
     firstIndex.push_back(0);
@@ -1089,48 +1232,135 @@ void ProtocolParty<FieldType>::generateKeysForPRSS() {
  */}
 
 template <class FieldType>
-void ProtocolParty<FieldType>::generateRandomSharesPRSS(int numOfRnadoms, vector<FieldType>& randomElementsToFill){
+void ProtocolParty<FieldType>::prssElements(int subset, uint64_t count, vector<FieldType>& out){
+
+    //one AES call for the whole batch instead of one per element
+    int fieldSizeBits = field->getElementSizeInBits();
+    vector<byte> bytes(count*8);
+    prssPrgs[subset].getPRGBytes(bytes, 0, count*8);
+
+    uint64_t *words = (uint64_t *)bytes.data();
+    out.resize(count);
+    for(uint64_t k=0; k<count; k++){
+        out[k] = field->GetElement(((unsigned long)words[k])>>(64 - fieldSizeBits));
+    }
+}
+
+template <class FieldType>
+void ProtocolParty<FieldType>::generateRandomSharesPRSS(uint64_t numOfRnadoms, vector<FieldType>& randomElementsToFill){
 
     if (flag_print) {
         cout << "in PRSS gen" << endl;
     }
 
-    int fieldSizeBits = field->getElementSizeInBits();
+    if(randomElementsToFill.size() < numOfRnadoms)
+        randomElementsToFill.resize(numOfRnadoms);
+
+    for(uint64_t i=0; i<numOfRnadoms; i++){
+        randomElementsToFill[i] = *field->GetZero();
+    }
+
+    vector<FieldType> rands;
 
-    for(int i=0; i<numOfRnadoms; i++){
+    //go over the subsets, drawing the values of each in batches
+    for(int j=0; j<prssPrgs.size();j++){
+        for(uint64_t start=0; start<numOfRnadoms; start+=PRSS_BATCH){
+            uint64_t len = min((uint64_t)PRSS_BATCH, numOfRnadoms - start);
+            prssElements(j, len, rands);
 
+            for(uint64_t k=0; k<len; k++){
+                randomElementsToFill[start + k] += rands[k] * prssSubsetElement[j];
+            }
+        }
+    }
+}
+
+template <class FieldType>
+void ProtocolParty<FieldType>::generateRandom2TAndTSharesPRSS(uint64_t numOfRandomPairs, vector<FieldType>& randomElementsToFill){
+
+    randomElementsToFill.resize(numOfRandomPairs*2);
+    for(uint64_t i=0; i<numOfRandomPairs*2; i++){
         randomElementsToFill[i] = *field->GetZero();
+    }
+
+    //powers alpha^1..alpha^T of my evaluation point
+    vector<FieldType> myPowers(T + 1);
+    myPowers[0] = *field->GetOne();
+    for(int l=1; l<=T; l++){
+        myPowers[l] = myPowers[l - 1] * alpha[m_partyId];
+    }
 
-        for(int j=0; j<prssPrgs.size();j++){
+    vector<FieldType> rands;
+    uint64_t batch = PRSS_BATCH / (T + 1) + 1;
 
-            if(fieldSizeBits<-32) {
-                //NOTE: check if getRandom32 is enough
-                //randomElementsToFill[i] +=field->GetElement(prssPrgs[j].getRandom32()) * prssSubsetElement[j];
-                randomElementsToFill[i] =
-                        randomElementsToFill[i] + field->GetElement(prssPrgs[j].getRandom32()) * prssSubsetElement[j];
+    for(int j=0; j<prssPrgs.size();j++){
+        for(uint64_t start=0; start<numOfRandomPairs; start+=batch){
+            uint64_t len = min(batch, numOfRandomPairs - start);
+            //the secret of the subset followed by its T zero-sharing coefficients
+            prssElements(j, len*(T + 1), rands);
+
+            for(uint64_t k=0; k<len; k++){
+                FieldType *r = rands.data() + k*(T + 1);
+                FieldType share = r[0] * prssSubsetElement[j];
+                FieldType zero = *field->GetZero();
+                for(int l=1; l<=T; l++){
+                    zero += r[l] * myPowers[l];
+                }
+
+                randomElementsToFill[2*(start + k)] += share;
+                randomElementsToFill[2*(start + k) + 1] += share + zero * prssSubsetElement[j];
             }
-            else{
-                //NOTE: check if getRandom32 is enough
-                //randomElementsToFill[i] +=field->GetElement(prssPrgs[j].getRandom32()) * prssSubsetElement[j];
-                randomElementsToFill[i] =
-                        randomElementsToFill[i] + field->GetElement(((unsigned long)prssPrgs[j].getRandom64())>>(64 - fieldSizeBits) ) * prssSubsetElement[j];
+        }
+    }
+}
+
+template <class FieldType>
+void ProtocolParty<FieldType>::generateRandomTAndAddSharesPRSS(uint64_t numOfRandomPairs, vector<FieldType>& randomElementsToFill){
+
+    randomElementsToFill.resize(numOfRandomPairs*2);
+    for(uint64_t i=0; i<numOfRandomPairs*2; i++){
+        randomElementsToFill[i] = *field->GetZero();
+    }
+
+    //every subset has N-T members
+    int subsetSize = N - T;
+    vector<FieldType> rands;
+    uint64_t batch = PRSS_BATCH / (subsetSize + 1) + 1;
+
+    for(int j=0; j<prssPrgs.size();j++){
+        //my position among the members of the subset
+        int pos = 0;
+        for(int i=0; i<m_partyId; i++){
+            if(allSubsets[j][i] == true)
+                pos++;
+        }
+        int next = (pos + 1) % subsetSize;
+
+        for(uint64_t start=0; start<numOfRandomPairs; start+=batch){
+            uint64_t len = min(batch, numOfRandomPairs - start);
+            //the secret of the subset followed by one zero-sharing value per member
+            prssElements(j, len*(subsetSize + 1), rands);
+
+            for(uint64_t k=0; k<len; k++){
+                FieldType *r = rands.data() + k*(subsetSize + 1);
+                randomElementsToFill[2*(start + k)] += r[0] * prssSubsetElement[j];
+                randomElementsToFill[2*(start + k) + 1] += r[1 + pos] - r[1 + next];
             }
         }
+    }
 
+    //the additive share is my part of the Lagrange interpolation at zero
+    for(uint64_t k=0; k<numOfRandomPairs; k++){
+        randomElementsToFill[2*k + 1] += firstRowVandInverse[m_partyId] * randomElementsToFill[2*k];
     }
 }
 
 template <class FieldType>
 void ProtocolParty<FieldType>::generateRandomShares(uint64_t numOfRandoms, vector<FieldType>& randomElementsToFill){
 
-
-    int index = 0;
     vector<vector<byte>> recBufsBytes(N);
-    int robin = 0;
     uint64_t no_random = numOfRandoms;
 
-    vector<FieldType> x1(N),y1(N), x2(N),y2(N), t1(N), r1(N), t2(N), r2(N);;
-
     vector<vector<FieldType>> sendBufsElements(N);
     vector<vector<byte>> sendBufsBytes(N);
 
@@ -1152,32 +1382,25 @@ void ProtocolParty<FieldType>::generateRandomShares(uint64_t numOfRandoms, vecto
         recBufsBytes[i].resize(no_buckets*field->getElementSizeInBytes());
     }
 
+    //the shares of the T parties after me are expanded from seeds
+    vector<vector<byte>> seeds;
+    vector<vector<FieldType>> seededShares;
+    beginSeededDealing(no_buckets, seeds, seededShares);
+
     /**
      *  generate random sharings.
      *  first degree t.
      *
      */
+    // random field elements, uniform distribution, the secret and the seeded shares fix each polynomial
+    vector<FieldType> secrets(no_buckets);
     for(int k=0; k < no_buckets; k++)
     {
-        // generate random degree-T polynomial
-        for(int i = 0; i < T+1; i++)
-        {
-            // A random field element, uniform distribution, note that x1[0] is the secret which is also random
-            x1[i] = field->Random();
-
-        }
-
-        matrix_vand.MatrixMult(x1, y1,T+1); // eval poly at alpha-positions
-
-        // prepare shares to be sent
-        for(int i=0; i < N; i++)
-        {
-            //cout << "y1[ " <<i<< "]" <<y1[i] << endl;
-            sendBufsElements[i][k] = y1[i];
-
-        }
+        secrets[k] = field->Random();
     }
 
+    seededSharings(secrets.data(), T, seededShares, 0, 1, no_buckets, sendBufsElements);
+
     if(flag_print) {
         for (int i = 0; i < N; i++) {
             for (int k = 0; k < sendBufsElements[0].size(); k++) {
@@ -1193,17 +1416,21 @@ void ProtocolParty<FieldType>::generateRandomShares(uint64_t numOfRandoms, vecto
     int fieldByteSize = field->getElementSizeInBytes();
     for(int i=0; i < N; i++)
     {
-        for(int j=0; j<sendBufsElements[i].size();j++) {
-            field->elementToBytes(sendBufsBytes[i].data() + (j * fieldByteSize), sendBufsElements[i][j]);
-        }
+        elementsToBytes(field, sendBufsBytes[i].data(), sendBufsElements[i].data(), sendBufsElements[i].size());
     }
 
+    //seeded parties get their seed instead of their shares
+    compressSeededShares(sendBufsBytes, seeds);
+    resizeSeededReceive(recBufsBytes);
+
     roundFunctionSync(sendBufsBytes, recBufsBytes,4);
 
+    expandSeededShares(recBufsBytes, no_buckets);
+
 
     if(flag_print) {
         for (int i = 0; i < N; i++) {
-            for (int k = 0; k < sendBufsBytes[0].size(); k++) {
+            for (int k = 0; k < sendBufsBytes[i].size(); k++) {
 
                 cout << "roundfunction4 send to " <<i <<" element: "<< k << " " << (int)sendBufsBytes[i][k] << endl;
             }
@@ -1215,36 +1442,335 @@ void ProtocolParty<FieldType>::generateRandomShares(uint64_t numOfRandoms, vecto
         }
     }
 
-    for(int k=0; k < no_buckets; k++) {
-        for (int i = 0; i < N; i++) {
-            t1[i] = field->bytesToElement(recBufsBytes[i].data() + (k * fieldByteSize));
+    extractRandomShares(recBufsBytes, 0, no_buckets, 1, randomElementsToFill);
+
+}
+
+
+template <class FieldType>
+void ProtocolParty<FieldType>::sumSharings(vector<FieldType>& vals, vector<FieldType>& sums){
+
+    uint64_t no_vals = vals.size();
+    int fieldByteSize = field->getElementSizeInBytes();
+
+    vector<vector<FieldType>> sendBufsElements(N);
+    vector<vector<byte>> sendBufsBytes(N);
+    vector<vector<byte>> recBufsBytes(N);
+
+    for (int i = 0; i < N; i++) {
+        sendBufsElements[i].resize(no_vals);
+        sendBufsBytes[i].resize(no_vals * fieldByteSize);
+        recBufsBytes[i].resize(no_vals * fieldByteSize);
+    }
 
+    vector<vector<byte>> seeds;
+    vector<vector<FieldType>> seededShares;
+    beginSeededDealing(no_vals, seeds, seededShares);
+
+    //the secret and the seeded shares fix each polynomial
+    seededSharings(vals.data(), T, seededShares, 0, 1, no_vals, sendBufsElements);
+
+    for (int i = 0; i < N; i++) {
+        if (!isSeeded(m_partyId, i)) {
+            elementsToBytes(field, sendBufsBytes[i].data(), sendBufsElements[i].data(), no_vals);
         }
-        matrix_vand_transpose.MatrixMult(t1, r1,N-T);
+    }
 
-        //copy the resulting vector to the array of randoms
-        for (int i = 0; i < N - T; i++) {
+    compressSeededShares(sendBufsBytes, seeds);
+    resizeSeededReceive(recBufsBytes);
+
+    roundFunctionSync(sendBufsBytes, recBufsBytes, 2);
+
+    expandSeededShares(recBufsBytes, no_vals);
+
+    //add up the sharings received from all parties (including mine)
+    sums.assign(no_vals, *(field->GetZero()));
+    vector<FieldType> received(no_vals);
+    for (int i = 0; i < N; i++) {
+        bytesToElements(field, received.data(), recBufsBytes[i].data(), no_vals);
+        batchAdd(sums.data(), sums.data(), received.data(), no_vals);
+    }
+}
 
-            randomElementsToFill[index] = r1[i];
-            index++;
 
+template <class FieldType>
+void ProtocolParty<FieldType>::generateFusedShares(uint64_t numT, uint64_t numTAndAdd, uint64_t numTAnd2T, vector<FieldType>& tShares,
+                                                   vector<FieldType>& tAndAddShares, vector<FieldType>& tAnd2TShares){
+
+    // the number of buckets of each kind (each bucket requires one sharing from each party and gives N-T)
+    uint64_t bucketsT = numT == 0 ? 0 : (numT / (N-T))+1;
+    uint64_t bucketsAdd = numTAndAdd == 0 ? 0 : (numTAndAdd / (N-T))+1;
+    uint64_t buckets2T = numTAnd2T == 0 ? 0 : (numTAnd2T / (N-T))+1;
+
+    //positions of the three kinds in the buffer of every party
+    uint64_t offsetAdd = bucketsT;
+    uint64_t offset2T = bucketsT + 2*bucketsAdd;
+    uint64_t count = offset2T + 2*buckets2T;
+
+    int fieldByteSize = field->getElementSizeInBytes();
+
+    vector<vector<FieldType>> sendBufsElements(N);
+    vector<vector<byte>> sendBufsBytes(N);
+    vector<vector<byte>> recBufsBytes(N);
+
+    for(int i=0; i < N; i++)
+    {
+        sendBufsElements[i].resize(count);
+        sendBufsBytes[i].resize(count*fieldByteSize);
+        recBufsBytes[i].resize(count*fieldByteSize);
+    }
+
+    //the shares of the T parties after me are expanded from seeds
+    vector<vector<byte>> seeds;
+    vector<vector<FieldType>> seededShares;
+    beginSeededDealing(count, seeds, seededShares);
+
+    // random field elements, uniform distribution, one per bucket of each kind
+    vector<FieldType> secrets(bucketsT + bucketsAdd + buckets2T);
+    for(uint64_t k=0; k < secrets.size(); k++)
+    {
+        secrets[k] = field->Random();
+    }
+    FieldType *secretsT = secrets.data();
+    FieldType *secretsAdd = secretsT + bucketsT;
+    FieldType *secrets2T = secretsAdd + bucketsAdd;
+
+    //T-sharings
+    seededSharings(secretsT, T, seededShares, 0, 1, bucketsT, sendBufsElements);
+
+    //T-sharings and additive sharings of the same secret
+    seededSharings(secretsAdd, T, seededShares, offsetAdd, 2, bucketsAdd, sendBufsElements);
+    for(uint64_t k=0; k < bucketsAdd; k++)
+    {
+        uint64_t pos = offsetAdd + 2*k + 1;
+        FieldType mine = secretsAdd[k];
+        for(int i=0; i < N; i++)
+        {
+            if(i == m_partyId)
+                continue;
+            if(isSeeded(m_partyId, i))
+                sendBufsElements[i][pos] = seededShares[i][pos];
+            else
+                sendBufsElements[i][pos] = field->Random();
+            //all shares generated so far are additive shares of the secret
+            mine = mine - sendBufsElements[i][pos];
+        }
+        sendBufsElements[m_partyId][pos] = mine;
+    }
+
+    //T-sharings and 2T-sharings of the same secret
+    seededSharings(secrets2T, T, seededShares, offset2T, 2, buckets2T, sendBufsElements);
+    seededSharings(secrets2T, 2*T, seededShares, offset2T + 1, 2, buckets2T, sendBufsElements);
+
+    for(int i=0; i < N; i++)
+    {
+        elementsToBytes(field, sendBufsBytes[i].data(), sendBufsElements[i].data(), sendBufsElements[i].size());
+    }
+
+    //seeded parties get their seed instead of their shares
+    compressSeededShares(sendBufsBytes, seeds);
+    resizeSeededReceive(recBufsBytes);
+
+    roundFunctionSync(sendBufsBytes, recBufsBytes, 4);
+
+    expandSeededShares(recBufsBytes, count);
+
+    extractRandomShares(recBufsBytes, 0, bucketsT, 1, tShares);
+    extractRandomShares(recBufsBytes, offsetAdd, bucketsAdd, 2, tAndAddShares);
+    extractRandomShares(recBufsBytes, offset2T, buckets2T, 2, tAnd2TShares);
+}
+
+template <class FieldType>
+void ProtocolParty<FieldType>::extractRandomShares(vector<vector<byte>> &recBufsBytes, uint64_t offset, uint64_t no_buckets, int lanes, vector<FieldType>& randomElementsToFill){
+
+    int fieldByteSize = field->getElementSizeInBytes();
+
+    //the received shares, bucket after bucket, the N parties' elements of a lane interleaved with the other lanes
+    vector<FieldType> received(no_buckets*N*lanes);
+    vector<FieldType> fromParty(no_buckets*lanes);
+    for (int i = 0; i < N; i++) {
+        bytesToElements(field, fromParty.data(), recBufsBytes[i].data() + offset*fieldByteSize, no_buckets*lanes);
+        for (uint64_t k = 0; k < no_buckets; k++) {
+            for (int s = 0; s < lanes; s++) {
+                received[(k*N + i)*lanes + s] = fromParty[k*lanes + s];
+            }
         }
     }
 
+    //maybe add some elements if a partial bucket is needed
+    randomElementsToFill.resize(no_buckets*(N-T)*lanes);
+    for (int s = 0; s < lanes; s++) {
+        batch_vand_transpose.apply(received.data() + s, randomElementsToFill.data() + s, no_buckets, lanes);
+    }
 }
 
+template <class FieldType>
+void ProtocolParty<FieldType>::initSeededDealing(){
+
+    for (int d = 0; d < 2; d++) {
+        //the secret and the seeded parties, for degree 2T also the T parties after them
+        int numKnown = (d + 1) * T + 1;
+
+        seededKnown[d].clear();
+        seededUnknown[d].clear();
+        seededKnown[d].push_back(-1);
+        for (int j = 1; j < numKnown; j++) {
+            seededKnown[d].push_back((m_partyId + j) % N);
+        }
+        seededUnknown[d].push_back(m_partyId);
+        for (int j = numKnown; j < N; j++) {
+            seededUnknown[d].push_back((m_partyId + j) % N);
+        }
+
+        vector<FieldType> knownPoints(seededKnown[d].size());
+        vector<FieldType> unknownPoints(seededUnknown[d].size());
+        knownPoints[0] = beta[0];
+        for (int j = 1; j < knownPoints.size(); j++) {
+            knownPoints[j] = alpha[seededKnown[d][j]];
+        }
+        for (int j = 0; j < unknownPoints.size(); j++) {
+            unknownPoints[j] = alpha[seededUnknown[d][j]];
+        }
+
+        //Lagrange coefficients of the known points, evaluated at the unknown points
+        batch_seeded[d].allocate(unknownPoints.size(), knownPoints.size());
+        for (int u = 0; u < unknownPoints.size(); u++) {
+            for (int j = 0; j < knownPoints.size(); j++) {
+                FieldType coef = *field->GetOne();
+                for (int l = 0; l < knownPoints.size(); l++) {
+                    if (l != j) {
+                        coef *= (unknownPoints[u] - knownPoints[l]) / (knownPoints[j] - knownPoints[l]);
+                    }
+                }
+                batch_seeded[d].at(u, j) = coef;
+            }
+        }
+    }
+}
 
 template <class FieldType>
-void ProtocolParty<FieldType>::generateRandom2TAndTShares(uint64_t numOfRandomPairs, vector<FieldType>& randomElementsToFill){
+bool ProtocolParty<FieldType>::isSeeded(int dealer, int receiver){
 
+    int dist = (receiver - dealer + N) % N;
+    return dist >= 1 && dist <= T;
+}
+
+template <class FieldType>
+void ProtocolParty<FieldType>::expandSeed(byte *seed, uint64_t count, vector<FieldType> &out){
+
+    vector<byte> vec;
+    //copy the random bytes to a vector held in the secret key
+    copy_byte_array_to_byte_vector(seed, 16, vec, 0);
+    SecretKey sk(vec, "");
+
+    PrgFromOpenSSLAES prg;
+    prg.setKey(sk);
+
+    int fieldSizeBits = field->getElementSizeInBits();
+    out.resize(count);
+    for (uint64_t k = 0; k < count; k++) {
+        out[k] = field->GetElement(((unsigned long)prg.getRandom64())>>(64 - fieldSizeBits));
+    }
+}
+
+template <class FieldType>
+void ProtocolParty<FieldType>::beginSeededDealing(uint64_t count, vector<vector<byte>> &seeds, vector<vector<FieldType>> &seededShares){
+
+    seeds.resize(N);
+    seededShares.resize(N);
+
+    //generate a fresh seed for each of the T parties after me
+    PrgFromOpenSSLAES prg(T*16);
+    auto randomKey = prg.generateKey(128);
+    prg.setKey(randomKey);
+
+    vector<byte> fromPrg(T*16);
+    prg.getPRGBytes(fromPrg, 0, T*16);
+
+    for (int j = 1; j <= T; j++) {
+        int i = (m_partyId + j) % N;
+        seeds[i].assign(fromPrg.begin() + (j - 1)*16, fromPrg.begin() + j*16);
+        expandSeed(seeds[i].data(), count, seededShares[i]);
+    }
+}
+
+template <class FieldType>
+void ProtocolParty<FieldType>::seededSharings(FieldType *secrets, int degree, vector<vector<FieldType>> &seededShares, uint64_t pos, uint64_t step,
+                                              uint64_t count, vector<vector<FieldType>> &sendBufsElements){
+
+    //shares the count secrets into sendBufsElements[i][pos + b*step], b < count
+    int d = (degree == T) ? 0 : 1;
+    int cols = seededKnown[d].size();
+    int rows = seededUnknown[d].size();
+    vector<FieldType> in(count*cols);
+    vector<FieldType> out(count*rows);
+
+    for (uint64_t b = 0; b < count; b++) {
+        uint64_t at = pos + b*step;
+        in[b*cols] = secrets[b];
+        for (int j = 1; j < cols; j++) {
+            int i = seededKnown[d][j];
+            if (isSeeded(m_partyId, i)) {
+                in[b*cols + j] = seededShares[i][at];
+            } else {
+                //the extra points of a degree-2T sharing
+                in[b*cols + j] = field->Random();
+            }
+            sendBufsElements[i][at] = in[b*cols + j];
+        }
+    }
+
+    batch_seeded[d].apply(in.data(), out.data(), count);
+
+    for (uint64_t b = 0; b < count; b++) {
+        for (int u = 0; u < rows; u++) {
+            sendBufsElements[seededUnknown[d][u]][pos + b*step] = out[b*rows + u];
+        }
+    }
+}
+
+template <class FieldType>
+void ProtocolParty<FieldType>::compressSeededShares(vector<vector<byte>> &sendBufsBytes, vector<vector<byte>> &seeds){
+
+    for (int i = 0; i < N; i++) {
+        if (isSeeded(m_partyId, i)) {
+            sendBufsBytes[i] = seeds[i];
+        }
+    }
+}
+
+template <class FieldType>
+void ProtocolParty<FieldType>::resizeSeededReceive(vector<vector<byte>> &recBufsBytes){
+
+    for (int i = 0; i < N; i++) {
+        if (isSeeded(i, m_partyId)) {
+            recBufsBytes[i].resize(16);
+        }
+    }
+}
+
+template <class FieldType>
+void ProtocolParty<FieldType>::expandSeededShares(vector<vector<byte>> &recBufsBytes, uint64_t count){
+
+    int fieldByteSize = field->getElementSizeInBytes();
+    vector<FieldType> shares;
+
+    for (int i = 0; i < N; i++) {
+        if (isSeeded(i, m_partyId)) {
+            expandSeed(recBufsBytes[i].data(), count, shares);
+            recBufsBytes[i].resize(count * fieldByteSize);
+            elementsToBytes(field, recBufsBytes[i].data(), shares.data(), count);
+        }
+    }
+}
+
+
+template <class FieldType>
+void ProtocolParty<FieldType>::generateRandom2TAndTShares(uint64_t numOfRandomPairs, vector<FieldType>& randomElementsToFill){
 
-    int index = 0;
     vector<vector<byte>> recBufsBytes(N);
-    int robin = 0;
     uint64_t no_random = numOfRandomPairs;
 
-    vector<FieldType> x1(N),y1(N), x2(N),y2(N), t1(N), r1(N), t2(N), r2(N);;
-
     vector<vector<FieldType>> sendBufsElements(N);
     vector<vector<byte>> sendBufsBytes(N);
 
@@ -1271,39 +1797,21 @@ void ProtocolParty<FieldType>::generateRandom2TAndTShares(uint64_t numOfRandomPa
      *  first degree t.
      *
      */
+    //the shares of the T parties after me are expanded from seeds, at 2k for degree T and 2k+1 for degree 2T
+    vector<vector<byte>> seeds;
+    vector<vector<FieldType>> seededShares;
+    beginSeededDealing(no_buckets*2, seeds, seededShares);
+
+    // random field elements, uniform distribution, each shared with degree T and with degree 2T
+    vector<FieldType> secrets(no_buckets);
     for(int k=0; k < no_buckets; k++)
     {
-        // generate random degree-T polynomial
-        for(int i = 0; i < T+1; i++)
-        {
-            // A random field element, uniform distribution, note that x1[0] is the secret which is also random
-            x1[i] = field->Random();
-
-        }
-
-        matrix_vand.MatrixMult(x1, y1,T+1); // eval poly at alpha-positions
-
-        x2[0] = x1[0];
-        // generate random degree-T polynomial
-        for(int i = 1; i < 2*T+1; i++)
-        {
-            // A random field element, uniform distribution, note that x1[0] is the secret which is also random
-            x2[i] = field->Random();
-
-        }
-
-        matrix_vand.MatrixMult(x2, y2,2*T+1);
-
-        // prepare shares to be sent
-        for(int i=0; i < N; i++)
-        {
-            //cout << "y1[ " <<i<< "]" <<y1[i] << endl;
-            sendBufsElements[i][2*k] = y1[i];
-            sendBufsElements[i][2*k + 1] = y2[i];
-
-        }
+        secrets[k] = field->Random();
     }
 
+    seededSharings(secrets.data(), T, seededShares, 0, 2, no_buckets, sendBufsElements);
+    seededSharings(secrets.data(), 2*T, seededShares, 1, 2, no_buckets, sendBufsElements);
+
     if(flag_print) {
         for (int i = 0; i < N; i++) {
             for (int k = 0; k < sendBufsElements[0].size(); k++) {
@@ -1319,46 +1827,33 @@ void ProtocolParty<FieldType>::generateRandom2TAndTShares(uint64_t numOfRandomPa
     int fieldByteSize = field->getElementSizeInBytes();
     for(int i=0; i < N; i++)
     {
-        for(int j=0; j<sendBufsElements[i].size();j++) {
-            field->elementToBytes(sendBufsBytes[i].data() + (j * fieldByteSize), sendBufsElements[i][j]);
-        }
+        elementsToBytes(field, sendBufsBytes[i].data(), sendBufsElements[i].data(), sendBufsElements[i].size());
     }
 
+    //seeded parties get their seed instead of their shares
+    compressSeededShares(sendBufsBytes, seeds);
+    resizeSeededReceive(recBufsBytes);
+
     roundFunctionSync(sendBufsBytes, recBufsBytes,4);
 
+    expandSeededShares(recBufsBytes, no_buckets*2);
+
 
     if(flag_print) {
         for (int i = 0; i < N; i++) {
-            for (int k = 0; k < sendBufsBytes[0].size(); k++) {
+            for (int k = 0; k < sendBufsBytes[i].size(); k++) {
 
                 cout << "roundfunction4 send to " <<i <<" element: "<< k << " " << (int)sendBufsBytes[i][k] << endl;
             }
         }
         for (int i = 0; i < N; i++) {
             for (int k = 0; k < recBufsBytes[0].size(); k++) {
-                cout << "roundfunction4 receive from " <<i <<" element: "<< k << " " << (int) recBufsBytes[i][k] << endl;
-            }
-        }
-    }
-
-    for(int k=0; k < no_buckets; k++) {
-        for (int i = 0; i < N; i++) {
-            t1[i] = field->bytesToElement(recBufsBytes[i].data() + (2*k * fieldByteSize));
-            t2[i] = field->bytesToElement(recBufsBytes[i].data() + ((2*k +1) * fieldByteSize));
-
-        }
-        matrix_vand_transpose.MatrixMult(t1, r1,N-T);
-        matrix_vand_transpose.MatrixMult(t2, r2,N-T);
-
-        //copy the resulting vector to the array of randoms
-        for (int i = 0; i < (N - T); i++) {
-
-            randomElementsToFill[index*2] = r1[i];
-            randomElementsToFill[index*2 +1] = r2[i];
-            index++;
-
+                cout << "roundfunction4 receive from " <<i <<" element: "<< k << " " << (int) recBufsBytes[i][k] << endl;
+            }
         }
     }
+
+    extractRandomShares(recBufsBytes, 0, no_buckets, 2, randomElementsToFill);
 }
 
 /**
@@ -1432,6 +1927,23 @@ void ProtocolParty<FieldType>::initializationPhase()
     //create the first row of the inverse of the nxn vandemonde matrix firstRowVandInverse
     initFirstRowInvVDM();
 
+    //row k of the transpose holds alpha[i]^k, only the N-T rows used for extraction are kept
+    batch_vand_transpose.allocate(N-T, N);
+    for(int i=0; i<N; i++)
+    {
+        batch_vand_transpose.at(0, i) = *field->GetOne();
+        for(int k=1; k<N-T; k++)
+        {
+            batch_vand_transpose.at(k, i) = batch_vand_transpose.at(k - 1, i) * alpha[i];
+        }
+    }
+
+    //interpolation matrices for seed-compressed dealing
+    initSeededDealing();
+
+    if(packFactor > 1)
+        initPacking();
+
 
 
     if(flag_print){
@@ -1618,6 +2130,55 @@ bool ProtocolParty<FieldType>::checkConsistency(vector<FieldType>& x, int d)
     return true;
 }
 
+template <class FieldType>
+void ProtocolParty<FieldType>::openBatch(vector<vector<byte>> &recBufsBytes, uint64_t count, FieldType *secrets)
+{
+    int numThreads = thread::hardware_concurrency();
+    if (numThreads < 1)
+        numThreads = 1;
+    if (count / numThreads < OPEN_MIN_PER_THREAD)
+        numThreads = count / OPEN_MIN_PER_THREAD + 1;
+
+    if (numThreads == 1) {
+        openBatchRange(recBufsBytes, 0, count, secrets);
+        return;
+    }
+
+    uint64_t perThread = (count + numThreads - 1) / numThreads;
+    vector<thread> threads(numThreads);
+    for (int t = 0; t < numThreads; t++) {
+        uint64_t first = min(count, t * perThread);
+        uint64_t last = min(count, (t + 1) * perThread);
+        threads[t] = thread(&ProtocolParty::openBatchRange, this, ref(recBufsBytes), first, last, secrets);
+    }
+    for (int t = 0; t < numThreads; t++) {
+        threads[t].join();
+    }
+}
+
+template <class FieldType>
+void ProtocolParty<FieldType>::openBatchRange(vector<vector<byte>> &recBufsBytes, uint64_t first, uint64_t last, FieldType *secrets)
+{
+    int fieldByteSize = field->getElementSizeInBytes();
+    vector<FieldType> shares(OPEN_BLOCK);
+
+    for (uint64_t start = first; start < last; start += OPEN_BLOCK) {
+        uint64_t end = min(last, start + OPEN_BLOCK);
+
+        for (uint64_t k = start; k < end; k++) {
+            secrets[k] = *field->GetZero();
+        }
+
+        //only the secret coefficient is needed, the first row of the inverse VDM gives it directly
+        for (int i = 0; i < N; i++) {
+            FieldType coef = firstRowVandInverse[i];
+            bytesToElements(field, shares.data(), recBufsBytes[i].data() + (start * fieldByteSize), end - start);
+            batchMul(shares.data(), shares.data(), &coef, end - start, 0);
+            batchAdd(secrets + start, secrets + start, shares.data(), end - start);
+        }
+    }
+}
+
 // Interpolate polynomial at position Zero
 template <class FieldType>
 FieldType ProtocolParty<FieldType>::interpolate(vector<FieldType> x)
@@ -1838,112 +2399,64 @@ int ProtocolParty<FieldType>::processMultDN(int indexInRandomArray) {
 
 
 template <class FieldType>
-void ProtocolParty<FieldType>::DNHonestMultiplication(vector<FieldType> a, vector<FieldType> b, vector<FieldType> &cToFill, uint64_t numOfTrupples, int offset) {
-
-    int index = 0;
-    //int numOfMultGates = circuit.getNrOfMultiplicationGates();
-    uint64_t numOfMultGates = numOfTrupples;
-    int fieldByteSize = field->getElementSizeInBytes();
-    vector<FieldType> xyMinusRShares(numOfTrupples);//hold both in the same vector to send in one batch
-    vector<byte> xyMinusRSharesBytes(numOfTrupples *fieldByteSize);//hold both in the same vector to send in one batch
+void ProtocolParty<FieldType>::DNHonestMultiplication(const vector<FieldType> &a, const vector<FieldType> &b, vector<FieldType> &cToFill, uint64_t numOfTrupples, int offset) {
+    DNHonestMultiplication(a.data(), b.data(), cToFill.data(), numOfTrupples, offset);
+}
 
-    vector<FieldType> xyMinusR;//hold both in the same vector to send in one batch
-    vector<byte> xyMinusRBytes;
+template <class FieldType>
+void ProtocolParty<FieldType>::DNHonestMultiplication(const FieldType *a, const FieldType *b, FieldType *cToFill, uint64_t numOfTrupples, int offset) {
 
-    vector<vector<byte>> recBufsBytes;
+    int fieldByteSize = field->getElementSizeInBytes();
+    uint64_t numBytes = numOfTrupples * fieldByteSize;
 
-    //int offset = numOfMultGates*2;
-    //int offset = 0;
+    //resize only grows the buffers when a larger layer comes along
+    dnSendBytes.resize(numBytes);
+    dnOpenBytes.resize(numBytes);
 
+    //compute the shares of xy-r, the 2T shares of r are the odd entries of randomTAnd2TShares
+    dnAllShares.resize(numOfTrupples);
+    batchMulSub(dnAllShares.data(), a, b, randomTAnd2TShares.data() + offset + 1, numOfTrupples, 2);
+    elementsToBytes(field, dnSendBytes.data(), dnAllShares.data(), numOfTrupples);
 
-    //generate the shares for x+a and y+b. do it in the same array to send once
-    for (int k = 0; k < numOfTrupples; k++)//go over only the logit gates
-    {
-        //compute the share of xy-r
-        xyMinusRShares[k] = a[k]*b[k] - randomTAnd2TShares[offset + 2*k+1];
+    if (packFactor > 1) {
 
+        //the kings send back shares of the packed xy-r instead of the values
+        packedOpenToShares(dnSendBytes, numOfTrupples, dnAllShares.data());
     }
+    else if (kingRotation) {
 
-    //set the acctual number of mult gate proccessed in this layer
-    xyMinusRSharesBytes.resize(numOfTrupples*fieldByteSize);
-    xyMinusR.resize(numOfTrupples);
-    xyMinusRBytes.resize(numOfTrupples*fieldByteSize);
-
-    for(int j=0; j<xyMinusRShares.size();j++) {
-        field->elementToBytes(xyMinusRSharesBytes.data() + (j * fieldByteSize), xyMinusRShares[j]);
+        //every party reconstructs its range of xy-r and sends it to all the others
+        kingOpen(dnSendBytes, numOfTrupples, dnAllShares.data());
     }
-
-    if (m_partyId == 0) {
-
-
+    else if (m_partyId == 0) {
 
         //just party 1 needs the recbuf
-        recBufsBytes.resize(N);
-
+        dnRecBufsBytes.resize(N);
         for (int i = 0; i < N; i++) {
-            recBufsBytes[i].resize(numOfTrupples*fieldByteSize);
+            dnRecBufsBytes[i].resize(numBytes);
         }
 
         //receive the shares from all the other parties
-        roundFunctionSyncForP1(xyMinusRSharesBytes, recBufsBytes);
-
-    }
-    else {//since I am not party 1 parties[0]->getID()=1
-
-        //send the shares to p1
-        parties[0]->getChannel()->write(xyMinusRSharesBytes.data(), xyMinusRSharesBytes.size());
-
-    }
+        roundFunctionSyncForP1(dnSendBytes, dnRecBufsBytes);
 
-    //reconstruct the shares recieved from the other parties
-    if (m_partyId == 0) {
-
-        vector<FieldType> xyMinurAllShares(N), yPlusB(N);
-
-        for (int k = 0;k < numOfTrupples; k++)//go over only the logit gates
-        {
-            for (int i = 0; i < N; i++) {
-
-                xyMinurAllShares[i] = field->bytesToElement(recBufsBytes[i].data() + (k * fieldByteSize));
-            }
-
-            // reconstruct the shares by P0
-            xyMinusR[k] = interpolate(xyMinurAllShares);
-
-            //convert to bytes
-            field->elementToBytes(xyMinusRBytes.data() + (k * fieldByteSize), xyMinusR[k]);
-
-        }
+        //reconstruct xy-r and convert to bytes
+        openBatch(dnRecBufsBytes, numOfTrupples, dnAllShares.data());
+        elementsToBytes(field, dnOpenBytes.data(), dnAllShares.data(), numOfTrupples);
 
         //send the reconstructed vector to all the other parties
-        sendFromP1(xyMinusRBytes);
-    }
-
-    else {//each party get the xy-r reconstruced vector from party 1
-
-        parties[0]->getChannel()->read(xyMinusRBytes.data(), xyMinusRBytes.size());
+        sendFromP1(dnOpenBytes);
     }
+    else {//since I am not party 1 parties[0]->getID()=1
 
-
-
-
-    //fill the xPlusAAndYPlusB array for all the parties except for party 1 that already have this array filled
-    if (m_partyId != 0) {
-
-        for (int i = 0; i < numOfTrupples; i++) {
-
-            xyMinusR[i] = field->bytesToElement(xyMinusRBytes.data() + (i * fieldByteSize));
-        }
+        //send the shares to p1 and get the xy-r reconstructed vector back
+        parties[0]->getChannel()->write(dnSendBytes.data(), numBytes);
+        parties[0]->getChannel()->read(dnOpenBytes.data(), numBytes);
+        bytesToElements(field, dnAllShares.data(), dnOpenBytes.data(), numOfTrupples);
     }
 
-
-    index = 0;
-
-    //after the xPlusAAndYPlusB array is filled, we are ready to fill the output of the mult gates
-    for (int k = 0; k < numOfTrupples; k++)//go over only the logit gates
-    {
-        cToFill[k] = randomTAnd2TShares[offset + 2*k] + xyMinusR[k];
-    }
+    //fill the output of the mult gates with xy-r plus the T shares of r (the even entries);
+    //a and b are not read past this point so cToFill may alias them
+    batchAdd(cToFill, dnAllShares.data(), randomTAnd2TShares.data() + offset, numOfTrupples, 2);
 
 }
 
@@ -2009,9 +2522,7 @@ int ProtocolParty<FieldType>::processMultGRR() {
     int fieldByteSize = field->getElementSizeInBytes();
     for(int i=0; i < N; i++)
     {
-        for(int j=0; j<sendBufsElements[i].size();j++) {
-            field->elementToBytes(sendBufsBytes[i].data() + (j * fieldByteSize), sendBufsElements[i][j]);
-        }
+        elementsToBytes(field, sendBufsBytes[i].data(), sendBufsElements[i].data(), sendBufsElements[i].size());
     }
 
     roundFunctionSync(sendBufsBytes, recBufsBytes, 4);
@@ -2097,9 +2608,7 @@ void ProtocolParty<FieldType>::GRRHonestMultiplication(FieldType *a, FieldType *
     int fieldByteSize = field->getElementSizeInBytes();
     for(int i=0; i < N; i++)
     {
-        for(int j=0; j<sendBufsElements[i].size();j++) {
-            field->elementToBytes(sendBufsBytes[i].data() + (j * fieldByteSize), sendBufsElements[i][j]);
-        }
+        elementsToBytes(field, sendBufsBytes[i].data(), sendBufsElements[i].data(), sendBufsElements[i].size());
     }
 
     roundFunctionSync(sendBufsBytes, recBufsBytes,4);
@@ -2156,7 +2665,10 @@ void ProtocolParty<FieldType>::offlineDNForMultiplication(int numOfTriples){
 
     //first generate 2*numOfTriples random shares
     //generateRandomShares(numOfTriples*2,randomTSharesOfflineMult);
-    generateRandom2TAndTShares(numOfTriples,randomTAnd2TShares);
+    if(genRandomSharesType=="PRSS")
+        generateRandom2TAndTSharesPRSS(numOfTriples,randomTAnd2TShares);
+    else
+        generateRandom2TAndTShares(numOfTriples,randomTAnd2TShares);
 
 
 }
@@ -2552,9 +3064,7 @@ void ProtocolParty<FieldType>::outputPhase()
     {
         sendBufsBytes[i].resize(sendBufsElements[i].size()*fieldByteSize);
         recBufBytes[i].resize(sendBufsElements[m_partyId].size()*fieldByteSize);
-        for(int j=0; j<sendBufsElements[i].size();j++) {
-            field->elementToBytes(sendBufsBytes[i].data() + (j * fieldByteSize), sendBufsElements[i][j]);
-        }
+        elementsToBytes(field, sendBufsBytes[i].data(), sendBufsElements[i].data(), sendBufsElements[i].size());
     }
 
     //comm->roundfunctionI(sendBufsBytes, recBufBytes,7);
@@ -2598,253 +3108,443 @@ void ProtocolParty<FieldType>::outputPhase()
 template <class FieldType>
 void ProtocolParty<FieldType>::roundFunctionSync(vector<vector<byte>> &sendBufs, vector<vector<byte>> &recBufs, int round) {
 
-    //cout<<"in roundFunctionSync "<< round<< endl;
+    recBufs[m_partyId] = move(sendBufs[m_partyId]);
+    for (int i = 0; i < parties.size(); i++) {
+        int id = parties[i]->getID();
+        exchange->write(i, sendBufs[id].data(), sendBufs[id].size());
+        exchange->read(i, recBufs[id].data(), recBufs[id].size());
+    }
+    exchange->wait();
+}
 
-    int numThreads = 10;//parties.size();
-    int numPartiesForEachThread;
+template <class FieldType>
+void ProtocolParty<FieldType>::roundFunctionSyncBroadcast(vector<byte> &message, vector<vector<byte>> &recBufs) {
 
-    if (parties.size() <= numThreads){
-        numThreads = parties.size();
-        numPartiesForEachThread = 1;
-    } else{
-        numPartiesForEachThread = (parties.size() + numThreads - 1)/ numThreads;
+    recBufs[m_partyId] = message;
+    for (int i = 0; i < parties.size(); i++) {
+        int id = parties[i]->getID();
+        exchange->write(i, message.data(), message.size());
+        exchange->read(i, recBufs[id].data(), recBufs[id].size());
     }
+    exchange->wait();
+}
 
+template <class FieldType>
+void ProtocolParty<FieldType>::roundFunctionSyncForP1(vector<byte> &myShare, vector<vector<byte>> &recBufs) {
 
-    recBufs[m_partyId] = move(sendBufs[m_partyId]);
-    //recieve the data using threads
-    vector<thread> threads(numThreads);
-    for (int t=0; t<numThreads; t++) {
-        if ((t + 1) * numPartiesForEachThread <= parties.size()) {
-            threads[t] = thread(&ProtocolParty::exchangeData, this, ref(sendBufs), ref(recBufs),
-                                t * numPartiesForEachThread, (t + 1) * numPartiesForEachThread);
-        } else {
-            threads[t] = thread(&ProtocolParty::exchangeData, this, ref(sendBufs), ref(recBufs), t * numPartiesForEachThread, parties.size());
-        }
-    }
-    for (int t=0; t<numThreads; t++){
-        threads[t].join();
+    recBufs[m_partyId] = myShare;
+    for (int i = 0; i < parties.size(); i++) {
+        int id = parties[i]->getID();
+        exchange->read(i, recBufs[id].data(), recBufs[id].size());
     }
-
+    exchange->wait();
 }
 
-
 template <class FieldType>
-void ProtocolParty<FieldType>::exchangeData(vector<vector<byte>> &sendBufs, vector<vector<byte>> &recBufs, int first, int last){
+void ProtocolParty<FieldType>::sendFromP1(vector<byte> &sendBuf) {
 
+    for (int i = 0; i < parties.size(); i++) {
+        exchange->write(i, sendBuf.data(), sendBuf.size());
+    }
+    exchange->wait();
+}
 
-    //cout<<"in exchangeData";
-    for (int i=first; i < last; i++) {
+template <class FieldType>
+void ProtocolParty<FieldType>::scatterFromP1(vector<vector<byte>> &sendBufs) {
 
-        if ((m_partyId) < parties[i]->getID()) {
+    for (int i = 0; i < parties.size(); i++) {
+        vector<byte> &sendBuf = sendBufs[parties[i]->getID()];
+        exchange->write(i, sendBuf.data(), sendBuf.size());
+    }
+    exchange->wait();
+}
 
+template <class FieldType>
+uint64_t ProtocolParty<FieldType>::kingFirst(int king, uint64_t count){
 
-            //send shares to my input bits
-            parties[i]->getChannel()->write(sendBufs[parties[i]->getID()].data(), sendBufs[parties[i]->getID()].size());
-            //cout<<"write the data:: my Id = " << m_partyId - 1<< "other ID = "<< parties[i]->getID() <<endl;
+    return count * king / N;
+}
 
+template <class FieldType>
+void ProtocolParty<FieldType>::kingGather(vector<byte> &shareBytes, uint64_t count, vector<vector<byte>> &recBufsBytes){
 
-            //receive shares from the other party and set them in the shares array
-            parties[i]->getChannel()->read(recBufs[parties[i]->getID()].data(), recBufs[parties[i]->getID()].size());
-            //cout<<"read the data:: my Id = " << m_partyId-1<< "other ID = "<< parties[i]->getID()<<endl;
+    int fieldByteSize = field->getElementSizeInBytes();
+    uint64_t myCount = kingFirst(m_partyId + 1, count) - kingFirst(m_partyId, count);
 
-        } else{
+    vector<vector<byte>> sendBufsBytes(N);
+    recBufsBytes.resize(N);
+    for (int i = 0; i < N; i++) {
+        sendBufsBytes[i].assign(shareBytes.begin() + kingFirst(i, count) * fieldByteSize,
+                                shareBytes.begin() + kingFirst(i + 1, count) * fieldByteSize);
+        recBufsBytes[i].resize(myCount * fieldByteSize);
+    }
 
+    roundFunctionSync(sendBufsBytes, recBufsBytes, 0);
+}
 
-            //receive shares from the other party and set them in the shares array
-            parties[i]->getChannel()->read(recBufs[parties[i]->getID()].data(), recBufs[parties[i]->getID()].size());
-            //cout<<"read the data:: my Id = " << m_partyId-1<< "other ID = "<< parties[i]->getID()<<endl;
+template <class FieldType>
+void ProtocolParty<FieldType>::kingOpen(vector<byte> &shareBytes, uint64_t count, FieldType *secrets){
 
+    int fieldByteSize = field->getElementSizeInBytes();
+    uint64_t myFirst = kingFirst(m_partyId, count);
+    uint64_t myCount = kingFirst(m_partyId + 1, count) - myFirst;
 
+    //reconstruct my range from everyone's shares of it
+    vector<vector<byte>> recBufsBytes;
+    kingGather(shareBytes, count, recBufsBytes);
+    openBatch(recBufsBytes, myCount, secrets + myFirst);
 
-            //send shares to my input bits
-            parties[i]->getChannel()->write(sendBufs[parties[i]->getID()].data(), sendBufs[parties[i]->getID()].size());
-            //cout<<"write the data:: my Id = " << m_partyId-1<< "other ID = "<< parties[i]->getID() <<endl;
+    //send my range to all the other parties and get theirs
+    vector<byte> openBytes(myCount * fieldByteSize);
+    elementsToBytes(field, openBytes.data(), secrets + myFirst, myCount);
+    for (int i = 0; i < N; i++) {
+        recBufsBytes[i].resize((kingFirst(i + 1, count) - kingFirst(i, count)) * fieldByteSize);
+    }
 
+    roundFunctionSyncBroadcast(openBytes, recBufsBytes);
 
+    for (int i = 0; i < N; i++) {
+        if (i == m_partyId) {
+            continue;
         }
-
+        uint64_t first = kingFirst(i, count);
+        uint64_t last = kingFirst(i + 1, count);
+        bytesToElements(field, secrets + first, recBufsBytes[i].data(), last - first);
     }
-
-
 }
 
+template <class FieldType>
+void ProtocolParty<FieldType>::kingAdditiveToThreshold(const FieldType *addShares, uint64_t count, FieldType *shares){
 
+    int fieldByteSize = field->getElementSizeInBytes();
+    uint64_t myFirst = kingFirst(m_partyId, count);
+    uint64_t myCount = kingFirst(m_partyId + 1, count) - myFirst;
 
+    vector<byte> shareBytes(count * fieldByteSize);
+    elementsToBytes(field, shareBytes.data(), addShares, count);
 
+    //add up the additive shares of my range
+    vector<vector<byte>> recBufsBytes;
+    kingGather(shareBytes, count, recBufsBytes);
+    vector<FieldType> sums(myCount, *field->GetZero());
+    vector<FieldType> received(myCount);
+    for (int i = 0; i < N; i++) {
+        bytesToElements(field, received.data(), recBufsBytes[i].data(), myCount);
+        batchAdd(sums.data(), sums.data(), received.data(), myCount);
+    }
 
-template <class FieldType>
-void ProtocolParty<FieldType>::roundFunctionSyncBroadcast(vector<byte> &message, vector<vector<byte>> &recBufs) {
-
-    //cout<<"in roundFunctionSyncBroadcast "<< endl;
+    //T-share the sums, the T parties after me expand their shares from a seed
+    vector<vector<byte>> seeds;
+    vector<vector<FieldType>> seededShares;
+    beginSeededDealing(myCount, seeds, seededShares);
 
-    int numThreads = 10;//parties.size();
-    int numPartiesForEachThread;
+    vector<vector<FieldType>> sendBufsElements(N);
+    vector<vector<byte>> sendBufsBytes(N);
+    for (int i = 0; i < N; i++) {
+        sendBufsElements[i].resize(myCount);
+    }
+    seededSharings(sums.data(), T, seededShares, 0, 1, myCount, sendBufsElements);
+    for (int i = 0; i < N; i++) {
+        sendBufsBytes[i].resize(myCount * fieldByteSize);
+        elementsToBytes(field, sendBufsBytes[i].data(), sendBufsElements[i].data(), myCount);
+    }
+    compressSeededShares(sendBufsBytes, seeds);
 
-    if (parties.size() <= numThreads){
-        numThreads = parties.size();
-        numPartiesForEachThread = 1;
-    } else{
-        numPartiesForEachThread = (parties.size() + numThreads - 1)/ numThreads;
+    //receive my shares of every king's range
+    for (int i = 0; i < N; i++) {
+        if (isSeeded(i, m_partyId)) {
+            recBufsBytes[i].resize(16);
+        } else {
+            recBufsBytes[i].resize((kingFirst(i + 1, count) - kingFirst(i, count)) * fieldByteSize);
+        }
     }
 
+    roundFunctionSync(sendBufsBytes, recBufsBytes, 1);
 
-    recBufs[m_partyId] = message;
-    //recieve the data using threads
-    vector<thread> threads(numThreads);
-    for (int t=0; t<numThreads; t++) {
-        if ((t + 1) * numPartiesForEachThread <= parties.size()) {
-            threads[t] = thread(&ProtocolParty::recData, this, ref(message), ref(recBufs),
-                                t * numPartiesForEachThread, (t + 1) * numPartiesForEachThread);
+    vector<FieldType> expanded;
+    for (int i = 0; i < N; i++) {
+        uint64_t first = kingFirst(i, count);
+        uint64_t last = kingFirst(i + 1, count);
+        if (isSeeded(i, m_partyId)) {
+            expandSeed(recBufsBytes[i].data(), last - first, expanded);
+            for (uint64_t k = first; k < last; k++) {
+                shares[k] = expanded[k - first];
+            }
         } else {
-            threads[t] = thread(&ProtocolParty::recData, this, ref(message),  ref(recBufs), t * numPartiesForEachThread, parties.size());
+            bytesToElements(field, shares + first, recBufsBytes[i].data(), last - first);
         }
     }
-    for (int t=0; t<numThreads; t++){
-        threads[t].join();
-    }
-
 }
 
-
 template <class FieldType>
-void ProtocolParty<FieldType>::recData(vector<byte> &message, vector<vector<byte>> &recBufs, int first, int last){
+FieldType ProtocolParty<FieldType>::lagrangeCoef(vector<FieldType> &points, int j, FieldType x){
 
+    //the Lagrange basis polynomial of points[j] evaluated at x
+    FieldType coef = *field->GetOne();
+    for (int l = 0; l < points.size(); l++) {
+        if (l != j) {
+            coef *= (x - points[l]) / (points[j] - points[l]);
+        }
+    }
+    return coef;
+}
 
-    //cout<<"in exchangeData";
-    for (int i=first; i < last; i++) {
+template <class FieldType>
+void ProtocolParty<FieldType>::initPacking(){
 
-        if ((m_partyId) < parties[i]->getID()) {
+    int k = packFactor;
+    if (k > T) {
+        throw runtime_error("packFactor must be at most T = " + to_string(T));
+    }
 
+    packPoints.resize(k);
+    for (int j = 0; j < k; j++) {
+        packPoints[j] = *field->GetZero() - field->GetElement(j);
+        for (int i = 0; i < N; i++) {
+            if (packPoints[j] == alpha[i]) {
+                throw runtime_error("the field is too small to pack " + to_string(k) + " values for " + to_string(N) + " parties");
+            }
+        }
+    }
 
-            //send shares to my input bits
-            parties[i]->getChannel()->write(message.data(), message.size());
-            //cout<<"write the data:: my Id = " << m_partyId - 1<< "other ID = "<< parties[i]->getID() <<endl;
+    for (int d = 0; d < 2; d++) {
+        //the packed secrets and the random shares of parties 0..degree-k fix the polynomial
+        int numFree = (d + 1) * T + 1 - k;
+        vector<FieldType> known(packPoints);
+        for (int i = 0; i < numFree; i++) {
+            known.push_back(alpha[i]);
+        }
+        batch_pack[d].allocate(N - numFree, known.size());
+        for (int u = numFree; u < N; u++) {
+            for (int j = 0; j < known.size(); j++) {
+                batch_pack[d].at(u - numFree, j) = lagrangeCoef(known, j, alpha[u]);
+            }
+        }
+    }
 
+    //any polynomial of degree < N is fixed by the N shares
+    packOpen.resize(k * N);
+    for (int j = 0; j < k; j++) {
+        for (int i = 0; i < N; i++) {
+            packOpen[j*N + i] = lagrangeCoef(alpha, i, packPoints[j]);
+        }
+    }
 
-            //receive shares from the other party and set them in the shares array
-            parties[i]->getChannel()->read(recBufs[parties[i]->getID()].data(), recBufs[parties[i]->getID()].size());
-            //cout<<"read the data:: my Id = " << m_partyId-1<< "other ID = "<< parties[i]->getID()<<endl;
+    //the shares of the degree k-1 polynomial through the packed values, from the N shares
+    packReencode.resize(N * N);
+    for (int i = 0; i < N; i++) {
+        for (int l = 0; l < N; l++) {
+            packReencode[i*N + l] = *field->GetZero();
+            for (int j = 0; j < k; j++) {
+                packReencode[i*N + l] += lagrangeCoef(packPoints, j, alpha[i]) * packOpen[j*N + l];
+            }
+        }
+    }
+}
 
-        } else{
+template <class FieldType>
+void ProtocolParty<FieldType>::packedSharings(FieldType *secrets, int degree, uint64_t count, vector<vector<FieldType>> &sendBufsElements,
+                                              uint64_t pos, uint64_t step){
 
+    //shares the count packs into sendBufsElements[i][pos + b*step], b < count
+    int k = packFactor;
+    int d = (degree == T) ? 0 : 1;
+    int numFree = degree + 1 - k;
+    int cols = batch_pack[d].getCols();
+    int rows = batch_pack[d].getRows();
+    vector<FieldType> in(count*cols);
+    vector<FieldType> out(count*rows);
 
-            //receive shares from the other party and set them in the shares array
-            parties[i]->getChannel()->read(recBufs[parties[i]->getID()].data(), recBufs[parties[i]->getID()].size());
-            //cout<<"read the data:: my Id = " << m_partyId-1<< "other ID = "<< parties[i]->getID()<<endl;
+    for (uint64_t b = 0; b < count; b++) {
+        uint64_t at = pos + b*step;
+        for (int j = 0; j < k; j++) {
+            in[b*cols + j] = secrets[b*k + j];
+        }
+        for (int i = 0; i < numFree; i++) {
+            in[b*cols + k + i] = field->Random();
+            sendBufsElements[i][at] = in[b*cols + k + i];
+        }
+    }
 
+    batch_pack[d].apply(in.data(), out.data(), count);
 
+    for (uint64_t b = 0; b < count; b++) {
+        for (int u = 0; u < rows; u++) {
+            sendBufsElements[numFree + u][pos + b*step] = out[b*rows + u];
+        }
+    }
+}
 
-            //send shares to my input bits
-            parties[i]->getChannel()->write(message.data(), message.size());
-            //cout<<"write the data:: my Id = " << m_partyId-1<< "other ID = "<< parties[i]->getID() <<endl;
+template <class FieldType>
+void ProtocolParty<FieldType>::packSharings(vector<FieldType>& vals, vector<FieldType>& packedSums){
 
+    uint64_t no_packs = numPacks(vals.size());
+    int fieldByteSize = field->getElementSizeInBytes();
 
-        }
+    vector<vector<FieldType>> sendBufsElements(N);
+    vector<vector<byte>> sendBufsBytes(N);
+    vector<vector<byte>> recBufsBytes(N);
 
+    for (int i = 0; i < N; i++) {
+        sendBufsElements[i].resize(no_packs);
+        sendBufsBytes[i].resize(no_packs * fieldByteSize);
+        recBufsBytes[i].resize(no_packs * fieldByteSize);
     }
 
+    //the slots past the last bin are zero
+    vector<FieldType> secrets(no_packs * packFactor, *field->GetZero());
+    copy(vals.begin(), vals.end(), secrets.begin());
+    packedSharings(secrets.data(), T, no_packs, sendBufsElements, 0, 1);
 
-}
+    for (int i = 0; i < N; i++) {
+        elementsToBytes(field, sendBufsBytes[i].data(), sendBufsElements[i].data(), no_packs);
+    }
 
+    roundFunctionSync(sendBufsBytes, recBufsBytes, 2);
 
+    //add up the sharings received from all parties (including mine)
+    packedSums.assign(no_packs, *(field->GetZero()));
+    vector<FieldType> received(no_packs);
+    for (int i = 0; i < N; i++) {
+        bytesToElements(field, received.data(), recBufsBytes[i].data(), no_packs);
+        batchAdd(packedSums.data(), packedSums.data(), received.data(), no_packs);
+    }
+}
 
 template <class FieldType>
-void ProtocolParty<FieldType>::roundFunctionSyncForP1(vector<byte> &myShare, vector<vector<byte>> &recBufs) {
+void ProtocolParty<FieldType>::generatePackedDoubleShares(uint64_t numOfRandomPairs, vector<FieldType>& randomElementsToFill){
 
-    //cout<<"in roundFunctionSyncBroadcast "<< endl;
+    int fieldByteSize = field->getElementSizeInBytes();
 
-    int numThreads = parties.size();
-    int numPartiesForEachThread;
+    //each bucket takes one packed double sharing from every party and gives N-T of them
+    uint64_t no_buckets = (numOfRandomPairs / (N-T)) + 1;
 
-    if (parties.size() <= numThreads){
-        numThreads = parties.size();
-        numPartiesForEachThread = 1;
-    } else{
-        numPartiesForEachThread = (parties.size() + numThreads - 1)/ numThreads;
+    vector<vector<FieldType>> sendBufsElements(N);
+    vector<vector<byte>> sendBufsBytes(N);
+    vector<vector<byte>> recBufsBytes(N);
+    for (int i = 0; i < N; i++) {
+        sendBufsElements[i].resize(no_buckets*2);
+        sendBufsBytes[i].resize(no_buckets*2*fieldByteSize);
+        recBufsBytes[i].resize(no_buckets*2*fieldByteSize);
     }
 
-
-    recBufs[m_partyId] = myShare;
-    //recieve the data using threads
-    vector<thread> threads(numThreads);
-    for (int t=0; t<numThreads; t++) {
-        if ((t + 1) * numPartiesForEachThread <= parties.size()) {
-            threads[t] = thread(&ProtocolParty::recDataToP1, this,  ref(recBufs),
-                                t * numPartiesForEachThread, (t + 1) * numPartiesForEachThread);
-        } else {
-            threads[t] = thread(&ProtocolParty::recDataToP1, this, ref(recBufs), t * numPartiesForEachThread, parties.size());
-        }
+    //the same random values packed with degree T at 2k and with degree 2T at 2k+1
+    vector<FieldType> secrets(no_buckets * packFactor);
+    for (uint64_t k = 0; k < secrets.size(); k++) {
+        secrets[k] = field->Random();
     }
-    for (int t=0; t<numThreads; t++){
-        threads[t].join();
+    packedSharings(secrets.data(), T, no_buckets, sendBufsElements, 0, 2);
+    packedSharings(secrets.data(), 2*T, no_buckets, sendBufsElements, 1, 2);
+
+    for (int i = 0; i < N; i++) {
+        elementsToBytes(field, sendBufsBytes[i].data(), sendBufsElements[i].data(), no_buckets*2);
     }
 
-}
+    roundFunctionSync(sendBufsBytes, recBufsBytes, 4);
 
+    extractRandomShares(recBufsBytes, 0, no_buckets, 2, randomElementsToFill);
+}
 
 template <class FieldType>
-void ProtocolParty<FieldType>::recDataToP1(vector<vector<byte>> &recBufs, int first, int last){
-
+void ProtocolParty<FieldType>::packedReencode(vector<vector<byte>> &recBufsBytes, uint64_t count, vector<vector<byte>> &sendBufsBytes){
 
-    //cout<<"in exchangeData";
-    for (int i=first; i < last; i++) {
+    int fieldByteSize = field->getElementSizeInBytes();
+    vector<FieldType> shares(N * OPEN_BLOCK);
+    vector<FieldType> out(OPEN_BLOCK);
 
-        parties[i]->getChannel()->read(recBufs[parties[i]->getID()].data(), recBufs[parties[i]->getID()].size());
-        //cout<<"read the data:: my Id = " << m_partyId-1<< "other ID = "<< parties[i]->getID()<<endl;
+    sendBufsBytes.resize(N);
+    for (int i = 0; i < N; i++) {
+        sendBufsBytes[i].resize(count * fieldByteSize);
     }
 
+    for (uint64_t start = 0; start < count; start += OPEN_BLOCK) {
+        uint64_t end = min(count, start + OPEN_BLOCK);
 
-}
-
+        for (int l = 0; l < N; l++) {
+            bytesToElements(field, shares.data() + l*OPEN_BLOCK, recBufsBytes[l].data() + (start * fieldByteSize), end - start);
+        }
 
+        for (int i = 0; i < N; i++) {
+            for (uint64_t k = start; k < end; k++) {
+                out[k - start] = *field->GetZero();
+            }
+            for (int l = 0; l < N; l++) {
+                FieldType coef = packReencode[i*N + l];
+                for (uint64_t k = start; k < end; k++) {
+                    out[k - start] += coef * shares[l*OPEN_BLOCK + (k - start)];
+                }
+            }
+            elementsToBytes(field, sendBufsBytes[i].data() + (start * fieldByteSize), out.data(), end - start);
+        }
+    }
+}
 
 template <class FieldType>
-void ProtocolParty<FieldType>::sendFromP1(vector<byte> &sendBuf) {
+void ProtocolParty<FieldType>::packedOpenToShares(vector<byte> &shareBytes, uint64_t count, FieldType *shares){
 
-    //cout<<"in roundFunctionSyncBroadcast "<< endl;
+    int fieldByteSize = field->getElementSizeInBytes();
+    vector<vector<byte>> recBufsBytes;
+    vector<vector<byte>> sendBufsBytes;
+
+    if (kingRotation) {
+        //I am the king of my range of packs, and get my shares of the other ranges from their kings
+        kingGather(shareBytes, count, recBufsBytes);
+        packedReencode(recBufsBytes, kingFirst(m_partyId + 1, count) - kingFirst(m_partyId, count), sendBufsBytes);
+        for (int i = 0; i < N; i++) {
+            recBufsBytes[i].resize((kingFirst(i + 1, count) - kingFirst(i, count)) * fieldByteSize);
+        }
 
-    int numThreads = parties.size();
-    int numPartiesForEachThread;
+        roundFunctionSync(sendBufsBytes, recBufsBytes, 1);
 
-    if (parties.size() <= numThreads){
-        numThreads = parties.size();
-        numPartiesForEachThread = 1;
-    } else{
-        numPartiesForEachThread = (parties.size() + numThreads - 1)/ numThreads;
+        for (int i = 0; i < N; i++) {
+            uint64_t first = kingFirst(i, count);
+            uint64_t last = kingFirst(i + 1, count);
+            bytesToElements(field, shares + first, recBufsBytes[i].data(), last - first);
+        }
+        return;
     }
 
-    //recieve the data using threads
-    vector<thread> threads(numThreads);
-    for (int t=0; t<numThreads; t++) {
-        if ((t + 1) * numPartiesForEachThread <= parties.size()) {
-            threads[t] = thread(&ProtocolParty::sendDataFromP1, this,  ref(sendBuf),
-                                t * numPartiesForEachThread, (t + 1) * numPartiesForEachThread);
-        } else {
-            threads[t] = thread(&ProtocolParty::sendDataFromP1, this, ref(sendBuf), t * numPartiesForEachThread, parties.size());
+    vector<byte> myShareBytes(count * fieldByteSize);
+    if (m_partyId == 0) {
+        recBufsBytes.resize(N);
+        for (int i = 0; i < N; i++) {
+            recBufsBytes[i].resize(count * fieldByteSize);
         }
+        roundFunctionSyncForP1(shareBytes, recBufsBytes);
+
+        packedReencode(recBufsBytes, count, sendBufsBytes);
+        myShareBytes = sendBufsBytes[0];
+        scatterFromP1(sendBufsBytes);
     }
-    for (int t=0; t<numThreads; t++){
-        threads[t].join();
+    else {
+        parties[0]->getChannel()->write(shareBytes.data(), shareBytes.size());
+        parties[0]->getChannel()->read(myShareBytes.data(), myShareBytes.size());
     }
 
+    bytesToElements(field, shares, myShareBytes.data(), count);
 }
 
 template <class FieldType>
-void ProtocolParty<FieldType>::sendDataFromP1(vector<byte> &sendBuf, int first, int last){
+void ProtocolParty<FieldType>::packedOpenBatch(vector<vector<byte>> &recBufsBytes, uint64_t count, FieldType *secrets){
 
-    for(int i=first; i < last; i++) {
-
-        parties[i]->getChannel()->write(sendBuf.data(), sendBuf.size());
+    int k = packFactor;
+    vector<FieldType> shares(count);
 
+    for (uint64_t b = 0; b < count*k; b++) {
+        secrets[b] = *field->GetZero();
     }
 
-
+    for (int i = 0; i < N; i++) {
+        bytesToElements(field, shares.data(), recBufsBytes[i].data(), count);
+        for (int j = 0; j < k; j++) {
+            FieldType coef = packOpen[j*N + i];
+            for (uint64_t b = 0; b < count; b++) {
+                secrets[b*k + j] += coef * shares[b];
+            }
+        }
+    }
 }
 
-
-
-
 template <class FieldType>
 void ProtocolParty<FieldType>::printSubSet( bitset<MAX_PRSS_PARTIES> &l){
     for(int i=0; i<MAX_PRSS_PARTIES;i++){
@@ -2879,6 +3579,7 @@ void ProtocolParty<FieldType>::subset(int size, int left, int index, bitset<MAX_
 template <class FieldType>
 ProtocolParty<FieldType>::~ProtocolParty()
 {
+    delete exchange;
     delete field;
 }
 
@@ -40,8 +40,7 @@ class Threshold : public ProtocolParty<FieldType>{
 		 *
 		 * Methods:
 		 * Constructor
-		 * roundFunctionSync, exchangeData, roundFunctionSyncBroadcast, recData, roundFunctionSyncForP1,
-		 *   recDataToP1, sendDataToP1, sendFromP1
+		 * roundFunctionSync, roundFunctionSyncBroadcast, roundFunctionSyncForP1, sendFromP1, scatterFromP1
 		 * run, runOffline, runOnline
 		 * readMyInputs
 		 * initialisationPhase
@@ -60,6 +59,7 @@ class Threshold : public ProtocolParty<FieldType>{
 		 */
 
 		uint64_t num_bins; // number of bins
+		uint64_t width; //shared values per vector of bins: num_bins, or the number of packs with packed sharing
 		uint64_t num_triples;//number of multiplication triples
 		uint64_t num_outs; //number of outputs
 		uint64_t sent_bytes; //total number of bytes sent
@@ -73,19 +73,27 @@ class Threshold : public ProtocolParty<FieldType>{
 		vector<FieldType> mult_outs; //threshold shares of s_j*a_j
 		vector<FieldType> outputs; //the shares of s_j*a_j
 		vector<FieldType> randomTAndAddShares; //shares of r_j for conversion of inputs to T-sharings
+		string conversionType; //additive-to-threshold conversion: Leader (open at P0 and reshare) or Direct (every party shares)
 		vector<FieldType> poly_outs; //shares of multiplication output of polynomial for threshold
 
 		Threshold(int argc, char* argv[]);
 
 		//read num_bins MPSI inputs
-		void readMPSIInputs(vector<vector<uint8_t>>& bins, uint64_t nbins);
+		template <class ShareType>
+		void readMPSIInputs(vector<vector<ShareType>>& bins, uint64_t nbins);
 
 		//convert shares to field type for testing
 		void convertSharestoFieldType(vector<uint8_t>& bins, vector<FieldType>& shares, uint64_t nbins);
 
-		//perform MPSI
+		//perform MPSI (offline followed by online)
 		uint64_t runMPSI();
 
+		//input-independent preprocessing for nbins bins; may run while the OPPRF phase is in progress
+		void runMPSIOffline(uint64_t nbins);
+
+		//evaluate the circuit on the inputs read by readMPSIInputs using the preprocessed randomness
+		uint64_t runMPSIOnline();
+
 		//prepare additive and T-threshold sharings of secret random value r_j using DN07's protocol
 		void modDoubleRandom(uint64_t no_random, vector<FieldType>& randomElementsToFill);
 
@@ -134,6 +142,8 @@ template <class FieldType> Threshold<FieldType>::Threshold(int argc, char* argv[
 	K = stoi(parser.getValueByKey(this->arguments, "threshold"));
 	p = stoi(parser.getValueByKey(this->arguments, "primemod"));
 
+	conversionType = parser.getValueByKey(this->arguments, "conversionType");
+
 	sent_bytes = 0;
 	recv_bytes = 0;
 
@@ -147,7 +157,8 @@ template <class FieldType> Threshold<FieldType>::Threshold(int argc, char* argv[
 /*
  * read num_bins MPSI inputs from parameters
  */
-template <class FieldType> void Threshold<FieldType>::readMPSIInputs(vector<vector<uint8_t>>& bins, uint64_t nbins) {
+template <class FieldType> template <class ShareType>
+void Threshold<FieldType>::readMPSIInputs(vector<vector<ShareType>>& bins, uint64_t nbins) {
   	uint8_t input;
     	uint64_t i = 0;
 	uint64_t j = 0;
@@ -202,23 +213,32 @@ template <class FieldType> void Threshold<FieldType>::convertSharestoFieldType(v
  * Generate shared randomness (preprocessing) and execute the protocol
  */
 template <class FieldType> uint64_t Threshold<FieldType>::runMPSI() {
-	uint64_t counter = 0;
+	runMPSIOffline(num_bins);
+	return runMPSIOnline();
+}
+
+/*
+ * Generate the input-independent shared randomness for nbins bins
+ */
+template <class FieldType> void Threshold<FieldType>::runMPSIOffline(uint64_t nbins) {
+	num_bins = nbins;
 	J = 2 * ceil((40 + log2(num_bins) + 3) / ceil(log2(p))) + 1; //number of times to repeat the final step to reduce false positive rate
-	num_outs = num_bins * J;
+	width = this->numPacks(num_bins);
+	num_outs = width * J;
         masks.resize(num_outs);
-        a_vals.resize(num_bins);
+        a_vals.resize(width);
         mult_outs.resize(num_outs);
-        outputs.resize(num_outs);
-	poly_outs.resize(num_bins);//The polynomial itself is only evaluated once per element
+        outputs.resize(num_outs * this->packFactor);
+	poly_outs.resize(width);//The polynomial itself is only evaluated once per element
 
 	//cout << this->m_partyId << ": J = " << J << endl;
 
 	int half = this->N / 2;
 	if(K < half) {
-		num_triples = (K + J) * num_bins;
+		num_triples = (K + J) * width;
 	}
 	else {
-		num_triples = (this->N - K + 1 + J) * num_bins;
+		num_triples = (this->N - K + 1 + J) * width;
 	}
 
 	auto t1 = high_resolution_clock::now();
@@ -227,26 +247,40 @@ template <class FieldType> uint64_t Threshold<FieldType>::runMPSI() {
 	auto dur1 = duration_cast<milliseconds>(t2-t1).count();
 	//cout << this->m_partyId << ": Time to initialise matrices is: " << dur1 << " milliseconds." << endl;
 
-	//Generate random T-sharings
+	//Generate random T-sharings, additive and T-sharings and T and 2T sharings for multiplication
         auto t3 = high_resolution_clock::now();
-        this->generateRandomShares(num_outs, masks);
+        if(this->packFactor > 1) {
+                //random T-sharings are random packed sharings, the multiplications need packed double sharings
+                if(this->genRandomSharesType == "PRSS") {
+                        this->generateRandomSharesPRSS(num_outs, masks);
+                }
+                else {
+                        this->generateRandomShares(num_outs, masks);
+                }
+                this->generatePackedDoubleShares(num_triples, this->randomTAnd2TShares);
+        }
+        else if(this->genRandomSharesType == "PRSS") {
+                this->generateRandomSharesPRSS(num_outs, masks);
+                if(conversionType != "Direct") {
+                        modDoubleRandom(num_bins, randomTAndAddShares);
+                }
+                this->generateRandom2TAndTSharesPRSS(num_triples, this->randomTAnd2TShares);
+        }
+        else {
+                //all three kinds are dealt in one round, sized by the number of multiplications of the circuit
+                this->generateFusedShares(num_outs, conversionType != "Direct" ? num_bins : 0, num_triples,
+                                masks, randomTAndAddShares, this->randomTAnd2TShares);
+        }
         auto t4 = high_resolution_clock::now();
         auto dur2 = duration_cast<milliseconds>(t4-t3).count();
-        //cout << this->m_partyId << ": T-sharings generated in " << dur3 << "milliseconds." << endl;
-
-        //Generate random additive and T-sharings
-	auto t5 = high_resolution_clock::now();
-        modDoubleRandom(num_bins, randomTAndAddShares);
-	auto t6 = high_resolution_clock::now();
-	auto dur3 = duration_cast<milliseconds>(t6-t5).count();
-	//cout << this->m_partyId << ": T- and additive sharings generated in " << dur2 << " milliseconds." << endl;
-
-        //Generate random T and 2T sharings for multiplication
-	auto t7 = high_resolution_clock::now();
-        this->generateRandom2TAndTShares(num_triples, this->randomTAnd2TShares);
-	auto t8 = high_resolution_clock::now();
-	auto dur4 = duration_cast<milliseconds>(t8-t7).count();
-	//cout << this->m_partyId << ": T- and 2T-sharings generated in " << dur4 << " milliseconds." << endl;
+        //cout << this->m_partyId << ": random sharings generated in " << dur2 << " milliseconds." << endl;
+}
+
+/*
+ * Execute the protocol on the inputs; runMPSIOffline must have completed
+ */
+template <class FieldType> uint64_t Threshold<FieldType>::runMPSIOnline() {
+	uint64_t counter = 0;
 
         //Evaluate the circuit; return quorum intersection size
         counter = evaluateCircuit();
@@ -258,12 +292,14 @@ template <class FieldType> uint64_t Threshold<FieldType>::runMPSI() {
  */
 template <class FieldType> void Threshold<FieldType>::modDoubleRandom(uint64_t no_random, vector<FieldType>& randomElementsToFill) {
 	//cout << this->m_partyId <<  ": Generating double sharings..." << endl;
-        int index = 0;
+        if(this->genRandomSharesType == "PRSS") {
+                //derived locally from the PRSS subset keys, no communication
+                this->generateRandomTAndAddSharesPRSS(no_random, randomElementsToFill);
+                return;
+        }
         int N = this->N;
         int T = this->T;
 
-        vector<FieldType> x1(N), y1(N), y2(N), t1(N), r1(N), t2(N), r2(N);
-
         vector<vector<FieldType>> sendBufsElements(N);
 
         vector<vector<byte>> sendBufsBytes(N);
@@ -290,58 +326,53 @@ template <class FieldType> void Threshold<FieldType>::modDoubleRandom(uint64_t n
          *  first degree T, then additive
          *
          */
+        //the shares of the T parties after me are expanded from seeds, at 2k for degree T and 2k+1 for additive
+        vector<vector<byte>> seeds;
+        vector<vector<FieldType>> seededShares;
+        this->beginSeededDealing(no_buckets*2, seeds, seededShares);
+
+        // random field elements, uniform distribution,
+        // the secret and the seeded shares fix each degree-T polynomial
+        vector<FieldType> secrets(no_buckets);
         for(uint64_t k=0; k < no_buckets; k++) {
-                // generate random degree-T polynomial
-                for(int i = 0; i < T+1; i++) {
-                        // A random field element, uniform distribution,
-                        // note that x1[0] is the secret which is also random
-                        x1[i] = this->field->Random();
-                }
-
-                this->matrix_vand.MatrixMult(x1, y1,T+1); // eval poly at alpha-positions
+                secrets[k] = this->field->Random();
+        }
 
-                y2[0] = x1[0];
-                // generate N-1 random elements
-                for(int i = 1; i < N; i++) {
-                        // A random field element, uniform distribution
-                        y2[i] = this->field->Random();
-                        //all y2[i] generated so far are additive shares of the secret x1[0]
-                        y2[0] = y2[0] - y2[i];
-                }
-		//testShareGenNoComm(y1, y2);
+        this->seededSharings(secrets.data(), T, seededShares, 0, 2, no_buckets, sendBufsElements);
 
-                // prepare shares to be sent
-                for(int i=0; i < N; i++) {
-                        //cout << "y1[ " <<i<< "]" <<y1[i] << " y2[ " << i << "]" << y2[i] << endl;
-                        sendBufsElements[i][2*k] = y1[i];
-                        sendBufsElements[i][2*k + 1] = y2[i];
+        for(uint64_t k=0; k < no_buckets; k++) {
+                FieldType mine = secrets[k];
+                // generate N-1 random elements, the seeded parties expand theirs
+                for(int i = 0; i < N; i++) {
+                        if(i == this->m_partyId) {
+                                continue;
+                        }
+                        if(this->isSeeded(this->m_partyId, i)) {
+                                sendBufsElements[i][2*k + 1] = seededShares[i][2*k + 1];
+                        }
+                        else {
+                                // A random field element, uniform distribution
+                                sendBufsElements[i][2*k + 1] = this->field->Random();
+                        }
+                        //all shares generated so far are additive shares of the secret
+                        mine = mine - sendBufsElements[i][2*k + 1];
                 }
-
+                sendBufsElements[this->m_partyId][2*k + 1] = mine;
         }
 
         for(int i=0; i < N; i++) {
-                for(uint64_t j=0; j<sendBufsElements[i].size();j++) {
-                        this->field->elementToBytes(sendBufsBytes[i].data() + (j * fieldByteSize), sendBufsElements[i][j]);
-                }
+                elementsToBytes(this->field, sendBufsBytes[i].data(), sendBufsElements[i].data(), sendBufsElements[i].size());
         }
 
+        //seeded parties get their seed instead of their shares
+        this->compressSeededShares(sendBufsBytes, seeds);
+        this->resizeSeededReceive(recBufsBytes);
+
         this->roundFunctionSync(sendBufsBytes, recBufsBytes, 1);
 
-        for(uint64_t k=0; k < no_buckets; k++) {
-                for (int i = 0; i < N; i++) {
-                        t1[i] = this->field->bytesToElement(recBufsBytes[i].data() + (2*k * fieldByteSize));
-                        t2[i] = this->field->bytesToElement(recBufsBytes[i].data() + ((2*k +1) * fieldByteSize));
-                }
-                this->matrix_vand_transpose.MatrixMult(t1, r1,N-T);
-                this->matrix_vand_transpose.MatrixMult(t2, r2,N-T);
-
-                //copy the resulting vector to the array of randoms
-                for (int i = 0; i < (N - T); i++) {
-                        randomElementsToFill[index*2] = r1[i];
-                        randomElementsToFill[index*2 +1] = r2[i];
-                        index++;
-                }
-        }
+        this->expandSeededShares(recBufsBytes, no_buckets*2);
+
+        this->extractRandomShares(recBufsBytes, 0, no_buckets, 2, randomElementsToFill);
 
         if (mpsi_print == true) {
                 cout << this->m_partyId << ": First pair of shares is " << randomElementsToFill[0] << " " << randomElementsToFill[1] << endl;
@@ -363,14 +394,11 @@ template <class FieldType> void Threshold<FieldType>::addShareOpen(uint64_t num_
 	vector<byte> sendBufsBytes;
 	vector<byte> aPlusRSharesBytes(num_vals*fieldByteSize);
 	int i;
-	uint64_t j;
 	int N = this->N;
 
 	secrets.resize(num_vals);
 
-	for(j=0; j<num_vals; j++) {
-		this->field->elementToBytes(aPlusRSharesBytes.data() + (j * fieldByteSize), shares[j]);
-	}
+	elementsToBytes(this->field, aPlusRSharesBytes.data(), shares.data(), num_vals);
 
 	if(this->m_partyId == 0) {
 		recBufsBytes.resize(N);
@@ -392,11 +420,11 @@ template <class FieldType> void Threshold<FieldType>::addShareOpen(uint64_t num_
 
 	//reconstruct the shares recieved from the other parties
 	if (this->m_partyId == 0) {
-		for (j = 0; j < num_vals; j++) {
-			secrets[j] = *(this->field->GetZero());
-			for (i = 0; i < N; i++) {
-                		secrets[j] += this->field->bytesToElement(recBufsBytes[i].data() + (j * fieldByteSize));
-           		 }
+		secrets.assign(num_vals, *(this->field->GetZero()));
+		vector<FieldType> received(num_vals);
+		for (i = 0; i < N; i++) {
+			bytesToElements(this->field, received.data(), recBufsBytes[i].data(), num_vals);
+			batchAdd(secrets.data(), secrets.data(), received.data(), num_vals);
 		}
 	}
 
@@ -410,68 +438,50 @@ template <class FieldType> void Threshold<FieldType>::reshare(vector<FieldType>&
         int T = this->T;
         uint64_t no_vals = vals.size();
 
-        vector<FieldType> x1(N), y1(N);
-
         vector<vector<FieldType>> sendBufsElements(N);
         vector<vector<byte>> sendBufsBytes(N);
-	vector<vector<byte>> recBufsBytes(N);
-	vector<vector<FieldType>> recBufsElements(N);
 
         int fieldByteSize = this->field->getElementSizeInBytes();
 
         if(this->m_partyId == 0) {
-                //generate T-sharings of the values in vals
-                for(uint64_t k = 0; k < no_vals; k++) {
-                        //set x1[0] as the secret to be shared
-                        x1[0] = vals[k];
-                        // generate random degree-T polynomial
-                        for(int i = 1; i < T+1; i++) {
-                                // A random field element, uniform distribution
-                                x1[i] = this->field->Random();
-                        }
+                //the T parties after the leader expand their shares from a seed
+                vector<vector<byte>> seeds;
+                vector<vector<FieldType>> seededShares;
+                this->beginSeededDealing(no_vals, seeds, seededShares);
 
-                        this->matrix_vand.MatrixMult(x1, y1,T+1); // eval poly at alpha-positions
-
-                        // prepare shares to be sent
-                        for(int i=0; i < N; i++) {
-                                //cout << "y1[ " <<i<< "]" <<y1[i] << endl;
-                                sendBufsElements[i].push_back(y1[i]);
+                //generate T-sharings of the values in vals, the secret and the seeded shares fix each polynomial
+                for(int i=0; i < N; i++) {
+                        sendBufsElements[i].resize(no_vals);
+                }
+                this->seededSharings(vals.data(), T, seededShares, 0, 1, no_vals, sendBufsElements);
+                for(uint64_t k = 0; k < no_vals; k++) {
+                        shares[k] = sendBufsElements[0][k];
+                }
+                for(int i=0; i < N; i++) {
+                        if(this->isSeeded(0, i)) {
+                                sendBufsElements[i].clear();
                         }
-
-                        shares[k] = y1[0];
                 }
 
-		//cout << "Sharings generated " << endl;
-
 		for (int i=0; i<N; i++) {
 			sendBufsBytes[i].resize(sendBufsElements[i].size() * fieldByteSize);
-			recBufsBytes[i].resize(num_bins * fieldByteSize);
-			for(uint64_t j=0; j<sendBufsElements[i].size(); j++) {
-				this->field->elementToBytes(sendBufsBytes[i].data() + (j * fieldByteSize), sendBufsElements[i][j]);
-			}
-			//cout << sendBufsElements[i].size() << " " << sendBufsBytes[i].size() << " " << recBufsBytes[i].size();
-		}
-	}
-	else {
-		for (int i=0; i<N; i++) {
-			sendBufsBytes[i].resize(num_bins * fieldByteSize);
-			recBufsBytes[i].resize(num_bins * fieldByteSize);
-			for (uint64_t j=0; j<num_bins; j++) {
-				this->field->elementToBytes(sendBufsBytes[i].data(), *(this->field->GetZero()));
-			}
+			elementsToBytes(this->field, sendBufsBytes[i].data(), sendBufsElements[i].data(), sendBufsElements[i].size());
 		}
-	}
-
-	//cout << "byte conversion done " << endl;
-
-        this->roundFunctionSync(sendBufsBytes, recBufsBytes, 2);
 
-	//cout << "roundFunctionSync() done ";
+		this->compressSeededShares(sendBufsBytes, seeds);
 
-	if (this->m_partyId != 0) {
-		for(uint64_t k=0; k < no_vals; k++) {
-                	shares[k] = this->field->bytesToElement(recBufsBytes[0].data() + (k * fieldByteSize));
-        	}
+		//only the leader has data: each party receives its shares, nothing is sent back
+		this->scatterFromP1(sendBufsBytes);
+	}
+	else if(this->isSeeded(0, this->m_partyId)) {
+		vector<byte> seed(16);
+		this->parties[0]->getChannel()->read(seed.data(), seed.size());
+		this->expandSeed(seed.data(), no_vals, shares);
+	}
+	else {
+		vector<byte> recBytes(no_vals * fieldByteSize);
+		this->parties[0]->getChannel()->read(recBytes.data(), recBytes.size());
+		bytesToElements(this->field, shares.data(), recBytes.data(), no_vals);
 	}
 	//cout << "converted back to field elements..." << endl;
 
@@ -490,25 +500,37 @@ template <class FieldType> void Threshold<FieldType>::reshare(vector<FieldType>&
  * to get the T-threshold sharing of the original shared secret
  */
 template <class FieldType> void Threshold<FieldType>::additiveToThreshold() {
-	uint64_t j;
+	if(this->packFactor > 1) {
+		//every party packs and T-shares its own additive shares, as in the Direct conversion
+		this->packSharings(add_a, a_vals);
+		return;
+	}
+	if(conversionType == "Direct") {
+		//every party T-shares its own additive share, the T-sharings are added locally
+		this->sumSharings(add_a, a_vals);
+		return;
+	}
+
         vector<FieldType> reconar; // reconstructed aj+rj
         reconar.resize(num_bins);
 
         //add additive share of rj to corresponding share of aj
-        for(j=0; j<num_bins; j++) {
-                add_a[j] = add_a[j] + randomTAndAddShares[j*2+1];
-        }
+        batchAdd(add_a.data(), add_a.data(), randomTAndAddShares.data() + 1, num_bins, 2);
 
-        //reconstruct additive shares, store in reconar
-        addShareOpen(num_bins, add_a, reconar);
+	if(this->kingRotation) {
+		//every party opens and reshares its own range of bins
+		this->kingAdditiveToThreshold(add_a.data(), num_bins, a_vals.data());
+	}
+	else {
+		//reconstruct additive shares, store in reconar
+		addShareOpen(num_bins, add_a, reconar);
 
-        //reshare and save in a_vals;
-        reshare(reconar, a_vals);
+		//reshare and save in a_vals;
+		reshare(reconar, a_vals);
+	}
 
 	//Subtract rj from the T-threshold sharings
-	for(j=0; j<num_bins; j++) {
-		a_vals[j] = a_vals[j] - randomTAndAddShares[j*2];
-	}
+	batchSub(a_vals.data(), a_vals.data(), randomTAndAddShares.data(), num_bins, 2);
 }
 
 /*
@@ -517,56 +539,59 @@ template <class FieldType> void Threshold<FieldType>::additiveToThreshold() {
  * Evaluate the polynomial s * p(x) = s * x * (x - 1) * ... * (x - (K - 1))
  * Else:
  * Evaluate the polynomial s * p(x) = s * (x - K) * (x - (K + 1)) * ... (x - N)
+ *
+ * The factors of p(x) are multiplied as a product tree: every level multiplies
+ * the first half of the remaining factors with the second half in a single
+ * batched DN multiplication, so p(x) takes ceil(log2(#factors)) rounds.
  */
 template <class FieldType> void Threshold<FieldType>::threshPoly() {
-	int fieldByteSize = this->field->getElementSizeInBytes();
-	vector<FieldType> left(num_bins);
-	vector<FieldType> right(num_bins);
 	vector<FieldType> psi(num_outs);
 	uint64_t i, j;
-	int offset, half;
+	uint64_t first, num_factors, pairs;
+	int offset = 0, half;
 
 	half = this->N / 2;
 
 	if(K < half) {
-		for(j = 0; j < num_bins; j++) {
-			poly_outs[j] = a_vals[j];
-		}
-
-		for(i = 1; i < K; i++) {
-			offset = (i - 1) * num_bins * 2;
-			for(j = 0; j < num_bins; j++) {
-				left[j] = poly_outs[j];
-				right[j] = a_vals[j] - this->field->GetElement(i);
-			}
-			this->DNHonestMultiplication(left, right, poly_outs, num_bins, offset);
-		}
-		offset = (K - 1) * num_bins * 2;
+		first = 0;
+		num_factors = K;
 	}
-
 	else {
-		for(j = 0; j < num_bins; j++) {
-			poly_outs[j] = a_vals[j] - this->field->GetElement(K);
-		}
+		first = K;
+		num_factors = this->N - K + 1;
+	}
+
+	//factor i occupies factors[i*width .. (i+1)*width)
+	vector<FieldType> factors(num_factors * width);
+	for(i = 0; i < num_factors; i++) {
+		FieldType c = this->field->GetElement(first + i);
+		batchSub(factors.data() + i * width, a_vals.data(), &c, width, 0);
+	}
 
-		for(i = K + 1; i <= this->N; i++) {
-			offset = (i - K - 1) * num_bins * 2;
-			for(j = 0; j < num_bins; j++) {
-				left[j] = poly_outs[j];
-				right[j] = a_vals[j] - this->field->GetElement(i);
+	while(num_factors > 1) {
+		pairs = num_factors / 2;
+		//products overwrite the first half in place
+		this->DNHonestMultiplication(factors.data(), factors.data() + pairs * width, factors.data(),
+					     pairs * width, offset);
+		offset += pairs * width * 2;
+		if(num_factors & 1) {
+			//carry the unpaired factor to the next level
+			for(j = 0; j < width; j++) {
+				factors[pairs * width + j] = factors[(num_factors - 1) * width + j];
 			}
-			this->DNHonestMultiplication(left, right, poly_outs, num_bins, offset);
 		}
-		offset = (this->N - K) * num_bins * 2;
+		num_factors = pairs + (num_factors & 1);
 	}
 
-	for(j = 0; j < num_bins; j++) {
-		int pos = (j * J);
-		for(i = 0; i < J; i++) {
-			psi[pos + i] = poly_outs[j];
-		}
+	for(j = 0; j < width; j++) {
+		poly_outs[j] = factors[j];
 	}
-	this->DNHonestMultiplication(masks, psi, mult_outs, num_outs, offset);
+
+	//copy i of the outputs occupies psi[i*width .. (i+1)*width), so packs are copied whole
+	for(i = 0; i < J; i++) {
+		copy(poly_outs.begin(), poly_outs.end(), psi.begin() + i * width);
+	}
+	this->DNHonestMultiplication(masks.data(), psi.data(), mult_outs.data(), num_outs, offset);
 }
 
 /*
@@ -578,11 +603,8 @@ template <class FieldType> void Threshold<FieldType>::leaderOpen() {
 	vector<byte> multbytes(num_outs * fieldByteSize);
 	vector<vector<byte>> recBufsBytes;
 	int i;
-	uint64_t j;
 
-	for(j=0; j < num_outs; j++) {
-		this->field->elementToBytes(multbytes.data() + (j*fieldByteSize), mult_outs[j]);
-	}
+	elementsToBytes(this->field, multbytes.data(), mult_outs.data(), num_outs);
 
 	if(this->m_partyId == 0) {
 		recBufsBytes.resize(this->N);
@@ -596,12 +618,11 @@ template <class FieldType> void Threshold<FieldType>::leaderOpen() {
 	}
 
 	if(this->m_partyId == 0) {
-		vector<FieldType> x1(this->N);
-		for(j=0; j<num_outs; j++) {
-			for(i=0; i<this->N; i++) {
-				x1[i] = this->field->bytesToElement(recBufsBytes[i].data() + (j*fieldByteSize));
-			}
-			outputs[j] = this->interpolate(x1);
+		if(this->packFactor > 1) {
+			this->packedOpenBatch(recBufsBytes, num_outs, outputs.data());
+		}
+		else {
+			this->openBatch(recBufsBytes, num_outs, outputs.data());
 		}
 	}
 }
@@ -636,16 +657,16 @@ template <class FieldType> uint64_t Threshold<FieldType>::evaluateCircuit() {
  */
 template <class FieldType> uint64_t Threshold<FieldType>::outputPrint() {
         vector<uint64_t> matches;
-        uint64_t i, j, pos;
+        uint64_t i, j;
 	bool allZero;
 	int half = this->N / 2;
+	uint64_t stride = width * this->packFactor; //copy j of bin i is at outputs[j*stride + i]
 
         for(i=0; i < num_bins; i++) {
-		pos = i * J;
 		if(K >= half) {
 			allZero = true;
 			for(j = 0; j < J; j++) {
-				if(outputs[pos + j] != *(this->field->GetZero())) {
+				if(outputs[j * stride + i] != *(this->field->GetZero())) {
 					allZero = false;
 					break;
 				}
@@ -658,7 +679,7 @@ template <class FieldType> uint64_t Threshold<FieldType>::outputPrint() {
 		else {
 			allZero = true;
 			for(j = 0; j < J; j++) {
-				if(outputs[pos + j] != *(this->field->GetZero())) {
+				if(outputs[j * stride + i] != *(this->field->GetZero())) {
 					allZero = false;
 					break;
 				}
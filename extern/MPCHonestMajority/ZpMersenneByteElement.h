@@ -23,44 +23,316 @@
  * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#ifndef ZPMERSENNEBYTEELEMENT_H
+#define ZPMERSENNEBYTEELEMENT_H
+
 #include <libscapi/include/primitives/Prg.hpp>
 #include <libscapi/include/primitives/Mersenne.hpp>
 
 #include "stdint.h"
 #include <iostream>
+#include "ZpSIMD.h"
+#include "FieldBytes.h"
 
 using namespace std;
 
+//number of bits of a Mersenne prime 2^k - 1, i.e. k
+constexpr uint8_t mersenneByteBits(uint8_t p) {
+	return (p == 0) ? 0 : 1 + mersenneByteBits(p >> 1);
+}
+
 //Performs field operations modulo a Mersenne prime of a byte or less in length
 //E.g 127, 31
-//The exact prime is defined in the .cpp file
+//The prime is a template parameter, so the reductions below fold to constants;
+//the primes used by the protocols are instantiated in the .cpp file
 
+template <uint8_t P>
 class ZpMersenneByteElement{
 
+	static_assert(P == 3 || P == 7 || P == 31 || P == 127, "P must be a Mersenne prime of at most 7 bits");
+
 	public:
+		static constexpr uint8_t p = P; // Mersenne Prime only; multiplication protocol does not work with non-Mersenne primes
+		static constexpr uint8_t p_size = mersenneByteBits(P); // size of bit representation of p
+
+		typedef uint8_t elem_type; //type of the shares the equality layer produces for this field
+
 		uint8_t elem; //The field element
 		ZpMersenneByteElement(); //Default constructor, sets elem = 0
 		ZpMersenneByteElement(uint8_t elem); //Constructor to set elem to a field element
-		
+
 		//Basic arithmetic operators
 		ZpMersenneByteElement& operator=(const ZpMersenneByteElement& other);
 		bool operator!=(const ZpMersenneByteElement& other);
 		bool operator==(const ZpMersenneByteElement& other);
-		
+
 		ZpMersenneByteElement operator+(const ZpMersenneByteElement& other);
 		ZpMersenneByteElement& operator+=(const ZpMersenneByteElement& other);
-		
+
 		ZpMersenneByteElement operator-(const ZpMersenneByteElement& other);
 		ZpMersenneByteElement& operator-=(const ZpMersenneByteElement& other);
-		
+
 		ZpMersenneByteElement operator*(const ZpMersenneByteElement& other);
 		ZpMersenneByteElement& operator*=(const ZpMersenneByteElement& other);
-		
+
+		//Division multiplies by the inverse, which is looked up in a table of all p elements
 		ZpMersenneByteElement operator/(const ZpMersenneByteElement& other);
 		ZpMersenneByteElement& operator/=(const ZpMersenneByteElement& other);
-		
-		//Field inverse of an element; not implemented
-		//ZpMersenneByteElement inv();
+
+		//Field inverse of an element, 0 for 0
+		ZpMersenneByteElement inv();
+
+		//Scalar arithmetic on the representation, shared with the batch kernels
+		static uint8_t addMod(uint8_t a, uint8_t b) {
+			uint8_t s = a + b;
+			return s >= p ? s - p : s;
+		}
+
+		static uint8_t subMod(uint8_t a, uint8_t b) {
+			uint8_t d = a + p - b;
+			return d >= p ? d - p : d;
+		}
+
+		static uint8_t mulMod(uint8_t a, uint8_t b) {
+			uint16_t prod = (uint16_t)a * (uint16_t)b;
+			uint8_t r = (prod & p) + (prod >> p_size);
+			return r >= p ? r - p : r;
+		}
+
+	private:
+		//inverses of all elements, computed on first use by search since p is at most 127
+		static const uint8_t *inverseTable();
+};
+
+template <uint8_t P> constexpr uint8_t ZpMersenneByteElement<P>::p;
+template <uint8_t P> constexpr uint8_t ZpMersenneByteElement<P>::p_size;
+
+template <uint8_t P>
+inline ::ostream& operator<<(::ostream& s, const ZpMersenneByteElement<P>& a){ return s << a.elem; };
+
+//the element is stored as the single byte that is sent, so arrays of elements are serialized with a memcpy
+template <uint8_t P>
+struct FieldIsWireFormat<ZpMersenneByteElement<P>> : std::true_type {
+	static_assert(sizeof(ZpMersenneByteElement<P>) == 1, "ZpMersenneByteElement must be a single byte");
 };
 
-inline ::ostream& operator<<(::ostream& s, const ZpMersenneByteElement& a){ return s << a.elem; };
+//Constructors
+template <uint8_t P>
+ZpMersenneByteElement<P>::ZpMersenneByteElement() {
+	this->elem = 0;
+}
+
+template <uint8_t P>
+ZpMersenneByteElement<P>::ZpMersenneByteElement(uint8_t elem) {
+	while (elem >= p) {
+		elem = elem - p;
+	}
+	this->elem = elem;
+}
+
+//Equality and boolean operators
+template <uint8_t P>
+ZpMersenneByteElement<P>& ZpMersenneByteElement<P>::operator=(const ZpMersenneByteElement& other) {
+	this->elem = other.elem;
+	return *this;
+}
+
+template <uint8_t P>
+bool ZpMersenneByteElement<P>::operator!=(const ZpMersenneByteElement& other) {
+	return !(other.elem == this->elem);
+}
+
+template <uint8_t P>
+bool ZpMersenneByteElement<P>::operator==(const ZpMersenneByteElement& other) {
+	return (other.elem == this->elem);
+}
+
+//Field addition
+template <uint8_t P>
+ZpMersenneByteElement<P> ZpMersenneByteElement<P>::operator+(const ZpMersenneByteElement& other) {
+	ZpMersenneByteElement answer;
+	answer.elem = addMod(this->elem, other.elem);
+	return answer;
+}
+
+template <uint8_t P>
+ZpMersenneByteElement<P>& ZpMersenneByteElement<P>::operator+=(const ZpMersenneByteElement& other) {
+	this->elem = addMod(this->elem, other.elem);
+	return *this;
+}
+
+//Field subtraction
+template <uint8_t P>
+ZpMersenneByteElement<P> ZpMersenneByteElement<P>::operator-(const ZpMersenneByteElement& other) {
+	ZpMersenneByteElement answer;
+	answer.elem = subMod(this->elem, other.elem);
+	return answer;
+}
+
+template <uint8_t P>
+ZpMersenneByteElement<P>& ZpMersenneByteElement<P>::operator-=(const ZpMersenneByteElement& other) {
+	this->elem = subMod(this->elem, other.elem);
+	return *this;
+}
+
+//Field multiplication; code based on ZpMersenneIntElement class
+template <uint8_t P>
+ZpMersenneByteElement<P> ZpMersenneByteElement<P>::operator*(const ZpMersenneByteElement& other) {
+	ZpMersenneByteElement answer;
+	answer.elem = mulMod(this->elem, other.elem);
+	return answer;
+}
+
+template <uint8_t P>
+ZpMersenneByteElement<P>& ZpMersenneByteElement<P>::operator*=(const ZpMersenneByteElement& other) {
+	this->elem = mulMod(this->elem, other.elem);
+	return *this;
+}
+
+//Field inverse
+template <uint8_t P>
+const uint8_t *ZpMersenneByteElement<P>::inverseTable() {
+	struct Table {
+		uint8_t inv[P];
+		Table() {
+			inv[0] = 0;
+			for (int x = 1; x < P; x++) {
+				for (int y = 1; y < P; y++) {
+					if ((x * y) % P == 1) {
+						inv[x] = (uint8_t) y;
+						break;
+					}
+				}
+			}
+		}
+	};
+	static const Table table;
+	return table.inv;
+}
+
+template <uint8_t P>
+ZpMersenneByteElement<P> ZpMersenneByteElement<P>::inv() {
+	return ZpMersenneByteElement(inverseTable()[this->elem]);
+}
+
+//Field division
+template <uint8_t P>
+ZpMersenneByteElement<P> ZpMersenneByteElement<P>::operator/(const ZpMersenneByteElement& other) {
+	ZpMersenneByteElement inverse(inverseTable()[other.elem]);
+	return inverse * (*this);
+}
+
+template <uint8_t P>
+ZpMersenneByteElement<P>& ZpMersenneByteElement<P>::operator/=(const ZpMersenneByteElement& other) {
+	ZpMersenneByteElement inverse(inverseTable()[other.elem]);
+	*this *= inverse;
+	return *this;
+}
+
+//Batch kernels, overloading the generic ones in FieldBatch.h with the same semantics.
+//They work on 64 (AVX-512BW) or 32 (AVX2) elements per instruction and fall back to scalar code otherwise.
+//Sums and differences stay below 2p < 256, so they are reduced with one conditional subtraction done as
+//min(x, x - p): when x < p the subtraction wraps around and the minimum keeps x.
+//Products are widened to 16 bits and reduced as (x & p) + (x >> p_size), followed by the same subtraction.
+
+#ifdef ZP_VEC_BYTES
+
+template <uint8_t P>
+inline zp_vec vecReduceSum(zp_vec s) {
+	return vecMin8(s, vecSub8(s, vecSet8(P)));
+}
+
+template <uint8_t P>
+inline zp_vec vecMulMod(zp_vec a, zp_vec b) {
+	zp_vec zero = vecZero();
+	zp_vec vp16 = vecSet16(P);
+	zp_vec lo = vecMul16(vecUnpackLo8(a, zero), vecUnpackLo8(b, zero));
+	zp_vec hi = vecMul16(vecUnpackHi8(a, zero), vecUnpackHi8(b, zero));
+	lo = vecAdd16(vecAnd(lo, vp16), vecShr16<ZpMersenneByteElement<P>::p_size>(lo));
+	hi = vecAdd16(vecAnd(hi, vp16), vecShr16<ZpMersenneByteElement<P>::p_size>(hi));
+	lo = vecMin16(lo, vecSub16(lo, vp16));
+	hi = vecMin16(hi, vecSub16(hi, vp16));
+	return vecPack16(lo, hi);
+}
+
+#endif
+
+template <uint8_t P>
+void batchAdd(ZpMersenneByteElement<P> *out, const ZpMersenneByteElement<P> *a, const ZpMersenneByteElement<P> *b, uint64_t n, int bStep = 1) {
+	uint8_t *o = (uint8_t *)out;
+	const uint8_t *x = (const uint8_t *)a;
+	const uint8_t *y = (const uint8_t *)b;
+	uint64_t k = 0;
+
+#ifdef ZP_VEC_BYTES
+	uint64_t end = vecEnd(n, bStep, ZP_VEC_BYTES);
+	for (; k < end; k += ZP_VEC_BYTES) {
+		zp_vec s = vecAdd8(vecLoad(x + k), vecLoadStep8(y + k*bStep, bStep));
+		vecStore(o + k, vecReduceSum<P>(s));
+	}
+#endif
+	for (; k < n; k++) {
+		o[k] = ZpMersenneByteElement<P>::addMod(x[k], y[k*bStep]);
+	}
+}
+
+template <uint8_t P>
+void batchSub(ZpMersenneByteElement<P> *out, const ZpMersenneByteElement<P> *a, const ZpMersenneByteElement<P> *b, uint64_t n, int bStep = 1) {
+	uint8_t *o = (uint8_t *)out;
+	const uint8_t *x = (const uint8_t *)a;
+	const uint8_t *y = (const uint8_t *)b;
+	uint64_t k = 0;
+
+#ifdef ZP_VEC_BYTES
+	uint64_t end = vecEnd(n, bStep, ZP_VEC_BYTES);
+	for (; k < end; k += ZP_VEC_BYTES) {
+		zp_vec d = vecSub8(vecAdd8(vecLoad(x + k), vecSet8(P)), vecLoadStep8(y + k*bStep, bStep));
+		vecStore(o + k, vecReduceSum<P>(d));
+	}
+#endif
+	for (; k < n; k++) {
+		o[k] = ZpMersenneByteElement<P>::subMod(x[k], y[k*bStep]);
+	}
+}
+
+template <uint8_t P>
+void batchMul(ZpMersenneByteElement<P> *out, const ZpMersenneByteElement<P> *a, const ZpMersenneByteElement<P> *b, uint64_t n, int bStep = 1) {
+	uint8_t *o = (uint8_t *)out;
+	const uint8_t *x = (const uint8_t *)a;
+	const uint8_t *y = (const uint8_t *)b;
+	uint64_t k = 0;
+
+#ifdef ZP_VEC_BYTES
+	uint64_t end = vecEnd(n, bStep, ZP_VEC_BYTES);
+	for (; k < end; k += ZP_VEC_BYTES) {
+		vecStore(o + k, vecMulMod<P>(vecLoad(x + k), vecLoadStep8(y + k*bStep, bStep)));
+	}
+#endif
+	for (; k < n; k++) {
+		o[k] = ZpMersenneByteElement<P>::mulMod(x[k], y[k*bStep]);
+	}
+}
+
+template <uint8_t P>
+void batchMulSub(ZpMersenneByteElement<P> *out, const ZpMersenneByteElement<P> *a, const ZpMersenneByteElement<P> *b,
+		 const ZpMersenneByteElement<P> *c, uint64_t n, int cStep = 1) {
+	uint8_t *o = (uint8_t *)out;
+	const uint8_t *x = (const uint8_t *)a;
+	const uint8_t *y = (const uint8_t *)b;
+	const uint8_t *z = (const uint8_t *)c;
+	uint64_t k = 0;
+
+#ifdef ZP_VEC_BYTES
+	uint64_t end = vecEnd(n, cStep, ZP_VEC_BYTES);
+	for (; k < end; k += ZP_VEC_BYTES) {
+		zp_vec prod = vecMulMod<P>(vecLoad(x + k), vecLoad(y + k));
+		zp_vec d = vecSub8(vecAdd8(prod, vecSet8(P)), vecLoadStep8(z + k*cStep, cStep));
+		vecStore(o + k, vecReduceSum<P>(d));
+	}
+#endif
+	for (; k < n; k++) {
+		o[k] = ZpMersenneByteElement<P>::subMod(ZpMersenneByteElement<P>::mulMod(x[k], y[k]), z[k*cStep]);
+	}
+}
+
+#endif //ZPMERSENNEBYTEELEMENT_H
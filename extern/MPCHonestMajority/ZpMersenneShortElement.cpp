@@ -0,0 +1,201 @@
+/*
+ * \author Nishka Dasgupta
+ * \email nishka.dasgupta@yahoo.com
+ * \organization Microsoft Research India
+ *
+ * \copyright the MIT License. Copyright (c) 2021 Microsoft Research
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation 
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ * A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "ZpMersenneShortElement.h"
+#include "ZpSIMD.h"
+#include "gmp.h"
+
+//Field inverse; the inverses of all elements are computed once with inv(i) = -(p / i) * inv(p mod i)
+static uint16_t inv_table[ZpMersenneShortElement::p];
+
+static bool fillInverseTable() {
+	const uint32_t p = ZpMersenneShortElement::p;
+	inv_table[0] = 0;
+	inv_table[1] = 1;
+	for (uint32_t i = 2; i < p; i++) {
+		inv_table[i] = (uint16_t)(p - (p / i) * inv_table[p % i] % p);
+	}
+	return true;
+}
+
+static bool inv_table_filled = fillInverseTable();
+
+ZpMersenneShortElement ZpMersenneShortElement::inv() {
+	return ZpMersenneShortElement(inv_table[this->elem]);
+}
+
+//Field division
+ZpMersenneShortElement ZpMersenneShortElement::operator/(const ZpMersenneShortElement& other) {
+	ZpMersenneShortElement inverse(inv_table[other.elem]);
+	return inverse * (*this);
+}
+
+ZpMersenneShortElement& ZpMersenneShortElement::operator/=(const ZpMersenneShortElement& other) {
+	ZpMersenneShortElement inverse(inv_table[other.elem]);
+	*this *= inverse;
+	return *this;
+}
+
+//Batch kernels
+//Sums and differences stay below 2p, so they are reduced with the conditional subtraction min(x, x - p).
+//The 26-bit products are split by mullo/mulhi into 16-bit halves lo and hi, and reduced as
+//(lo & p) + ((lo >> 13) | (hi << 3)), followed by the same subtraction.
+
+#ifdef ZP_VEC_BYTES
+
+#define ZP_SHORT_LANES (ZP_VEC_BYTES / 2)
+
+static inline zp_vec vecShortReduceSum(zp_vec s) {
+	return vecMin16(s, vecSub16(s, vecSet16(ZpMersenneShortElement::p)));
+}
+
+static inline zp_vec vecShortMulMod(zp_vec a, zp_vec b) {
+	zp_vec lo = vecMul16(a, b);
+	zp_vec hi = vecMulHi16(a, b);
+	zp_vec top = vecOr(vecShr16<ZpMersenneShortElement::p_size>(lo), vecShl16<16 - ZpMersenneShortElement::p_size>(hi));
+	return vecShortReduceSum(vecAdd16(vecAnd(lo, vecSet16(ZpMersenneShortElement::p)), top));
+}
+
+#endif
+
+void batchAdd(ZpMersenneShortElement *out, const ZpMersenneShortElement *a, const ZpMersenneShortElement *b, uint64_t n, int bStep) {
+	uint16_t *o = (uint16_t *)out;
+	const uint16_t *x = (const uint16_t *)a;
+	const uint16_t *y = (const uint16_t *)b;
+	uint64_t k = 0;
+
+#ifdef ZP_VEC_BYTES
+	uint64_t end = vecEnd(n, bStep, ZP_SHORT_LANES);
+	for (; k < end; k += ZP_SHORT_LANES) {
+		zp_vec s = vecAdd16(vecLoad(x + k), vecLoadStep16(y + k*bStep, bStep));
+		vecStore(o + k, vecShortReduceSum(s));
+	}
+#endif
+	for (; k < n; k++) {
+		o[k] = ZpMersenneShortElement::addMod(x[k], y[k*bStep]);
+	}
+}
+
+void batchSub(ZpMersenneShortElement *out, const ZpMersenneShortElement *a, const ZpMersenneShortElement *b, uint64_t n, int bStep) {
+	uint16_t *o = (uint16_t *)out;
+	const uint16_t *x = (const uint16_t *)a;
+	const uint16_t *y = (const uint16_t *)b;
+	uint64_t k = 0;
+
+#ifdef ZP_VEC_BYTES
+	zp_vec vp = vecSet16(ZpMersenneShortElement::p);
+	uint64_t end = vecEnd(n, bStep, ZP_SHORT_LANES);
+	for (; k < end; k += ZP_SHORT_LANES) {
+		zp_vec d = vecSub16(vecAdd16(vecLoad(x + k), vp), vecLoadStep16(y + k*bStep, bStep));
+		vecStore(o + k, vecShortReduceSum(d));
+	}
+#endif
+	for (; k < n; k++) {
+		o[k] = ZpMersenneShortElement::subMod(x[k], y[k*bStep]);
+	}
+}
+
+void batchMul(ZpMersenneShortElement *out, const ZpMersenneShortElement *a, const ZpMersenneShortElement *b, uint64_t n, int bStep) {
+	uint16_t *o = (uint16_t *)out;
+	const uint16_t *x = (const uint16_t *)a;
+	const uint16_t *y = (const uint16_t *)b;
+	uint64_t k = 0;
+
+#ifdef ZP_VEC_BYTES
+	uint64_t end = vecEnd(n, bStep, ZP_SHORT_LANES);
+	for (; k < end; k += ZP_SHORT_LANES) {
+		vecStore(o + k, vecShortMulMod(vecLoad(x + k), vecLoadStep16(y + k*bStep, bStep)));
+	}
+#endif
+	for (; k < n; k++) {
+		o[k] = ZpMersenneShortElement::mulMod(x[k], y[k*bStep]);
+	}
+}
+
+void batchMulSub(ZpMersenneShortElement *out, const ZpMersenneShortElement *a, const ZpMersenneShortElement *b,
+		 const ZpMersenneShortElement *c, uint64_t n, int cStep) {
+	uint16_t *o = (uint16_t *)out;
+	const uint16_t *x = (const uint16_t *)a;
+	const uint16_t *y = (const uint16_t *)b;
+	const uint16_t *z = (const uint16_t *)c;
+	uint64_t k = 0;
+
+#ifdef ZP_VEC_BYTES
+	zp_vec vp = vecSet16(ZpMersenneShortElement::p);
+	uint64_t end = vecEnd(n, cStep, ZP_SHORT_LANES);
+	for (; k < end; k += ZP_SHORT_LANES) {
+		zp_vec prod = vecShortMulMod(vecLoad(x + k), vecLoad(y + k));
+		zp_vec d = vecSub16(vecAdd16(prod, vp), vecLoadStep16(z + k*cStep, cStep));
+		vecStore(o + k, vecShortReduceSum(d));
+	}
+#endif
+	for (; k < n; k++) {
+		o[k] = ZpMersenneShortElement::subMod(ZpMersenneShortElement::mulMod(x[k], y[k]), z[k*cStep]);
+	}
+}
+
+//TemplateField constructors and functions
+//Code taken from TemplateField.cpp
+template <>
+TemplateField<ZpMersenneShortElement>::TemplateField(long fieldParam) {
+	this->fieldParam = ZpMersenneShortElement::p;
+	this->elementSizeInBytes = 2;//round up to the next byte
+	this->elementSizeInBits = ZpMersenneShortElement::p_size;
+
+	auto randomKey = prg.generateKey(128);
+	prg.setKey(randomKey);
+
+	m_ZERO = new ZpMersenneShortElement(0); //additive identity of field
+	m_ONE = new ZpMersenneShortElement(1); //multiplicative identity of field
+}
+
+template <>
+ZpMersenneShortElement TemplateField<ZpMersenneShortElement>::GetElement(long b) {
+	if(b == 1)
+		return *m_ONE;
+
+	if(b == 0)
+		return *m_ZERO;
+
+	ZpMersenneShortElement element(b);
+	return element;
+}
+
+template <>
+void TemplateField<ZpMersenneShortElement>::elementToBytes(unsigned char* elementInBytes, ZpMersenneShortElement& element){
+	memcpy(elementInBytes, (byte*)(&element.elem), 2);
+}
+
+template <>
+void TemplateField<ZpMersenneShortElement>::elementVectorToByteVector(vector<ZpMersenneShortElement> &elementVector, vector<byte> &byteVector){
+	copy_byte_array_to_byte_vector((byte *)elementVector.data(), elementVector.size()*elementSizeInBytes, byteVector,0);
+}
+
+template <>
+ZpMersenneShortElement TemplateField<ZpMersenneShortElement>::bytesToElement(uint8_t* elemenetInBytes){
+	uint16_t elem;
+	memcpy(&elem, elemenetInBytes, 2);
+	return ZpMersenneShortElement(elem);
+}
@@ -0,0 +1,115 @@
+/*
+ * \author Nishka Dasgupta
+ * \email nishka.dasgupta@yahoo.com
+ * \organization Microsoft Research India
+ *
+ * \copyright the MIT License. Copyright (c) 2021 Microsoft Research
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining 
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+ * and/or sell copies of the Software, and to permit persons to whom the Software
+ * is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all 
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A 
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR LIABILITY, WHETHER IN AN ACTION 
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ZPMERSENNESHORTELEMENT_H
+#define ZPMERSENNESHORTELEMENT_H
+
+#include <libscapi/include/primitives/Prg.hpp>
+#include <libscapi/include/primitives/Mersenne.hpp>
+
+#include "stdint.h"
+#include <iostream>
+#include "FieldBytes.h"
+
+using namespace std;
+
+//Performs field operations modulo the 13-bit Mersenne prime 8191
+//Used by the Circuit and Threshold variants when the number of parties does not fit
+//under the largest byte-sized prime (127); shares are two bytes long
+
+class ZpMersenneShortElement{
+
+	public:
+		static constexpr uint16_t p = 8191; // Mersenne Prime only; multiplication protocol does not work with non-Mersenne primes
+		static constexpr uint16_t p_size = 13; // size of bit representation of p
+
+		typedef uint16_t elem_type; //type of the shares the equality layer produces for this field
+
+		uint16_t elem; //The field element
+		ZpMersenneShortElement() : elem(0) {} //Default constructor, sets elem = 0
+		ZpMersenneShortElement(uint16_t elem) : elem(elem % p) {} //Constructor to set elem to a field element
+
+		//Basic arithmetic operators
+		ZpMersenneShortElement& operator=(const ZpMersenneShortElement& other) { elem = other.elem; return *this; }
+		bool operator!=(const ZpMersenneShortElement& other) { return other.elem != elem; }
+		bool operator==(const ZpMersenneShortElement& other) { return other.elem == elem; }
+
+		ZpMersenneShortElement operator+(const ZpMersenneShortElement& other) { return fromReduced(addMod(elem, other.elem)); }
+		ZpMersenneShortElement& operator+=(const ZpMersenneShortElement& other) { elem = addMod(elem, other.elem); return *this; }
+
+		ZpMersenneShortElement operator-(const ZpMersenneShortElement& other) { return fromReduced(subMod(elem, other.elem)); }
+		ZpMersenneShortElement& operator-=(const ZpMersenneShortElement& other) { elem = subMod(elem, other.elem); return *this; }
+
+		ZpMersenneShortElement operator*(const ZpMersenneShortElement& other) { return fromReduced(mulMod(elem, other.elem)); }
+		ZpMersenneShortElement& operator*=(const ZpMersenneShortElement& other) { elem = mulMod(elem, other.elem); return *this; }
+
+		//Division multiplies by the inverse, which is looked up in a table of all p elements
+		ZpMersenneShortElement operator/(const ZpMersenneShortElement& other);
+		ZpMersenneShortElement& operator/=(const ZpMersenneShortElement& other);
+
+		//Field inverse of an element, 0 for 0
+		ZpMersenneShortElement inv();
+
+		//Scalar arithmetic on the representation, shared with the batch kernels
+		static uint16_t addMod(uint16_t a, uint16_t b) {
+			uint16_t s = a + b;
+			return s >= p ? s - p : s;
+		}
+
+		static uint16_t subMod(uint16_t a, uint16_t b) {
+			uint16_t d = a + p - b;
+			return d >= p ? d - p : d;
+		}
+
+		static uint16_t mulMod(uint16_t a, uint16_t b) {
+			uint32_t prod = (uint32_t)a * (uint32_t)b;
+			uint16_t r = (prod & p) + (prod >> p_size);
+			return r >= p ? r - p : r;
+		}
+
+	private:
+		static ZpMersenneShortElement fromReduced(uint16_t x) {
+			ZpMersenneShortElement answer;
+			answer.elem = x;
+			return answer;
+		}
+};
+
+inline ::ostream& operator<<(::ostream& s, const ZpMersenneShortElement& a){ return s << a.elem; };
+
+//the element is stored as the two bytes that are sent, so arrays of elements are serialized with a memcpy
+static_assert(sizeof(ZpMersenneShortElement) == 2, "ZpMersenneShortElement must be two bytes");
+template <>
+struct FieldIsWireFormat<ZpMersenneShortElement> : std::true_type {};
+
+//Batch kernels, overloading the generic ones in FieldBatch.h with the same semantics.
+//They work on 32 (AVX-512BW) or 16 (AVX2) elements per instruction and fall back to scalar code otherwise.
+void batchAdd(ZpMersenneShortElement *out, const ZpMersenneShortElement *a, const ZpMersenneShortElement *b, uint64_t n, int bStep = 1);
+void batchSub(ZpMersenneShortElement *out, const ZpMersenneShortElement *a, const ZpMersenneShortElement *b, uint64_t n, int bStep = 1);
+void batchMul(ZpMersenneShortElement *out, const ZpMersenneShortElement *a, const ZpMersenneShortElement *b, uint64_t n, int bStep = 1);
+void batchMulSub(ZpMersenneShortElement *out, const ZpMersenneShortElement *a, const ZpMersenneShortElement *b,
+		 const ZpMersenneShortElement *c, uint64_t n, int cStep = 1);
+
+#endif //ZPMERSENNESHORTELEMENT_H
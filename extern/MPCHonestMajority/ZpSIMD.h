@@ -0,0 +1,114 @@
+#ifndef MPCHONESTMAJORITY_ZPSIMD_H
+#define MPCHONESTMAJORITY_ZPSIMD_H
+
+#include <stdint.h>
+#include <immintrin.h>
+
+/**
+ * Thin wrappers over the widest integer vectors available at compile time (AVX-512BW, else AVX2), shared by
+ * the batch kernels of the small Mersenne fields. ZP_VEC_BYTES is the vector width in bytes and is left
+ * undefined when neither instruction set is enabled, in which case the kernels only run their scalar code.
+ */
+
+#if defined(__AVX512BW__)
+
+#define ZP_VEC_BYTES 64
+typedef __m512i zp_vec;
+
+static inline zp_vec vecLoad(const void *x) { return _mm512_loadu_si512(x); }
+static inline void vecStore(void *x, zp_vec v) { _mm512_storeu_si512(x, v); }
+static inline zp_vec vecSet8(uint8_t x) { return _mm512_set1_epi8(x); }
+static inline zp_vec vecSet16(uint16_t x) { return _mm512_set1_epi16(x); }
+static inline zp_vec vecSet32(uint32_t x) { return _mm512_set1_epi32(x); }
+static inline zp_vec vecAdd8(zp_vec a, zp_vec b) { return _mm512_add_epi8(a, b); }
+static inline zp_vec vecSub8(zp_vec a, zp_vec b) { return _mm512_sub_epi8(a, b); }
+static inline zp_vec vecMin8(zp_vec a, zp_vec b) { return _mm512_min_epu8(a, b); }
+static inline zp_vec vecAdd16(zp_vec a, zp_vec b) { return _mm512_add_epi16(a, b); }
+static inline zp_vec vecSub16(zp_vec a, zp_vec b) { return _mm512_sub_epi16(a, b); }
+static inline zp_vec vecMin16(zp_vec a, zp_vec b) { return _mm512_min_epu16(a, b); }
+static inline zp_vec vecMul16(zp_vec a, zp_vec b) { return _mm512_mullo_epi16(a, b); }
+static inline zp_vec vecMulHi16(zp_vec a, zp_vec b) { return _mm512_mulhi_epu16(a, b); }
+static inline zp_vec vecAnd(zp_vec a, zp_vec b) { return _mm512_and_si512(a, b); }
+static inline zp_vec vecOr(zp_vec a, zp_vec b) { return _mm512_or_si512(a, b); }
+template <int SHIFT> inline zp_vec vecShr16(zp_vec a) { return _mm512_srli_epi16(a, SHIFT); }
+template <int SHIFT> inline zp_vec vecShl16(zp_vec a) { return _mm512_slli_epi16(a, SHIFT); }
+static inline zp_vec vecZero() { return _mm512_setzero_si512(); }
+static inline zp_vec vecUnpackLo8(zp_vec a, zp_vec b) { return _mm512_unpacklo_epi8(a, b); }
+static inline zp_vec vecUnpackHi8(zp_vec a, zp_vec b) { return _mm512_unpackhi_epi8(a, b); }
+static inline zp_vec vecPack16(zp_vec a, zp_vec b) { return _mm512_packus_epi16(a, b); }
+//packus works per 128-bit lane, put the 64-bit halves of a before those of b
+static inline zp_vec vecOrderPacked(zp_vec v) {
+	return _mm512_permutexvar_epi64(_mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7), v);
+}
+static inline zp_vec vecPackOrdered16(zp_vec a, zp_vec b) { return vecOrderPacked(_mm512_packus_epi16(a, b)); }
+static inline zp_vec vecPackOrdered32(zp_vec a, zp_vec b) { return vecOrderPacked(_mm512_packus_epi32(a, b)); }
+
+#elif defined(__AVX2__)
+
+#define ZP_VEC_BYTES 32
+typedef __m256i zp_vec;
+
+static inline zp_vec vecLoad(const void *x) { return _mm256_loadu_si256((const __m256i *)x); }
+static inline void vecStore(void *x, zp_vec v) { _mm256_storeu_si256((__m256i *)x, v); }
+static inline zp_vec vecSet8(uint8_t x) { return _mm256_set1_epi8(x); }
+static inline zp_vec vecSet16(uint16_t x) { return _mm256_set1_epi16(x); }
+static inline zp_vec vecSet32(uint32_t x) { return _mm256_set1_epi32(x); }
+static inline zp_vec vecAdd8(zp_vec a, zp_vec b) { return _mm256_add_epi8(a, b); }
+static inline zp_vec vecSub8(zp_vec a, zp_vec b) { return _mm256_sub_epi8(a, b); }
+static inline zp_vec vecMin8(zp_vec a, zp_vec b) { return _mm256_min_epu8(a, b); }
+static inline zp_vec vecAdd16(zp_vec a, zp_vec b) { return _mm256_add_epi16(a, b); }
+static inline zp_vec vecSub16(zp_vec a, zp_vec b) { return _mm256_sub_epi16(a, b); }
+static inline zp_vec vecMin16(zp_vec a, zp_vec b) { return _mm256_min_epu16(a, b); }
+static inline zp_vec vecMul16(zp_vec a, zp_vec b) { return _mm256_mullo_epi16(a, b); }
+static inline zp_vec vecMulHi16(zp_vec a, zp_vec b) { return _mm256_mulhi_epu16(a, b); }
+static inline zp_vec vecAnd(zp_vec a, zp_vec b) { return _mm256_and_si256(a, b); }
+static inline zp_vec vecOr(zp_vec a, zp_vec b) { return _mm256_or_si256(a, b); }
+template <int SHIFT> inline zp_vec vecShr16(zp_vec a) { return _mm256_srli_epi16(a, SHIFT); }
+template <int SHIFT> inline zp_vec vecShl16(zp_vec a) { return _mm256_slli_epi16(a, SHIFT); }
+static inline zp_vec vecZero() { return _mm256_setzero_si256(); }
+static inline zp_vec vecUnpackLo8(zp_vec a, zp_vec b) { return _mm256_unpacklo_epi8(a, b); }
+static inline zp_vec vecUnpackHi8(zp_vec a, zp_vec b) { return _mm256_unpackhi_epi8(a, b); }
+static inline zp_vec vecPack16(zp_vec a, zp_vec b) { return _mm256_packus_epi16(a, b); }
+//packus works per 128-bit lane, put the 64-bit halves of a before those of b
+static inline zp_vec vecOrderPacked(zp_vec v) { return _mm256_permute4x64_epi64(v, 0xD8); }
+static inline zp_vec vecPackOrdered16(zp_vec a, zp_vec b) { return vecOrderPacked(_mm256_packus_epi16(a, b)); }
+static inline zp_vec vecPackOrdered32(zp_vec a, zp_vec b) { return vecOrderPacked(_mm256_packus_epi32(a, b)); }
+
+#endif
+
+#ifdef ZP_VEC_BYTES
+
+//reads one vector of bytes at x[k*step] for step 0, 1 or 2
+static inline zp_vec vecLoadStep8(const uint8_t *x, int step) {
+	if (step == 1) {
+		return vecLoad(x);
+	}
+	if (step == 0) {
+		return vecSet8(x[0]);
+	}
+	zp_vec even = vecSet16(0x00FF);
+	return vecPackOrdered16(vecAnd(vecLoad(x), even), vecAnd(vecLoad(x + ZP_VEC_BYTES), even));
+}
+
+//reads one vector of 16-bit words at x[k*step] for step 0, 1 or 2
+static inline zp_vec vecLoadStep16(const uint16_t *x, int step) {
+	if (step == 1) {
+		return vecLoad(x);
+	}
+	if (step == 0) {
+		return vecSet16(x[0]);
+	}
+	zp_vec even = vecSet32(0x0000FFFF);
+	return vecPackOrdered32(vecAnd(vecLoad(x), even), vecAnd(vecLoad(x + ZP_VEC_BYTES/2), even));
+}
+
+//end of the vectorized part of an n element loop with the given number of lanes;
+//the last load at step 2 reads one element past the last one used, so leave one element to spare
+static inline uint64_t vecEnd(uint64_t n, int step, uint64_t lanes) {
+	uint64_t spare = (step == 2) ? 1 : 0;
+	return (n > spare) ? (n - spare) / lanes * lanes : 0;
+}
+
+#endif
+
+#endif //MPCHONESTMAJORITY_ZPSIMD_H
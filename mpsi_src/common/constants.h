@@ -34,5 +34,7 @@ namespace ENCRYPTO {
 
 constexpr uint64_t __61_bit_mask = 0x1FFFFFFFFFFFFFFFull;
 constexpr std::size_t symsecbits = 128;
+// Comparisons per Equality chunk (multiple of 8), bounds the per-thread memory
+constexpr int64_t equality_chunk_size = 1 << 20;
 
 }
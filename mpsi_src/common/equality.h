@@ -32,11 +32,66 @@
 #include<ctime>
 #include <thread>
 #include<bitset>
+#include <cstring>
+#include <type_traits>
+#include <algorithm>
+#include <stdexcept>
+#include <cerrno>
+#include <sys/socket.h>
 #include "constants.h"
+#include "silent_ot.h"
 
 using namespace sci;
 using namespace std;
 
+/*
+ * Exchanges len bytes with the other party: send_buf goes out while
+ * recv_buf is filled. The generic version orders the two directions by
+ * party; the NetIO one writes on the raw socket from a separate thread so
+ * both directions are in flight at once. A failed send is thrown on the
+ * calling thread once the exchange is over.
+ */
+template<typename IO>
+void exchange_data(IO* io, int party, const uint8_t* send_buf, uint8_t* recv_buf, int64_t len) {
+	if(party == sci::ALICE) {
+		io->send_data(send_buf, len);
+		io->recv_data(recv_buf, len);
+	}
+	else {
+		io->recv_data(recv_buf, len);
+		io->send_data(send_buf, len);
+	}
+}
+
+inline void exchange_data(sci::NetIO* io, int party, const uint8_t* send_buf, uint8_t* recv_buf, int64_t len) {
+	// Anything still buffered in the stream has to leave before the raw writes
+	io->flush();
+	int send_errno = 0;
+	std::thread sender([io, send_buf, len, &send_errno]() {
+		int64_t sent = 0;
+		while(sent < len) {
+			ssize_t res = ::send(io->consocket, send_buf + sent, len - sent, MSG_NOSIGNAL);
+			if(res < 0) {
+				if(errno == EINTR)
+					continue;
+				send_errno = errno;
+				return;
+			}
+			sent += res;
+		}
+	});
+	try {
+		io->recv_data(recv_buf, len);
+	} catch(...) {
+		sender.join();
+		throw;
+	}
+	sender.join();
+	if(send_errno != 0)
+		throw std::runtime_error(std::string("exchange_data: send failed: ") + strerror(send_errno));
+	io->counter += len;
+}
+
 template<typename IO> class Equality {
 	public:
 		IO* io= nullptr;
@@ -44,16 +99,19 @@ template<typename IO> class Equality {
 		TripleGenerator<IO>* triple_gen;
 		int party;
 		int l, r, log_alpha, beta, beta_pow;
-		int num_digits, num_cmps;
+		int num_digits;
+		int64_t num_cmps;
 		int num_triples;
 		uint8_t mask_beta, mask_r;
-		Triple* triples_std;
-		uint8_t* leaf_eq;
-		int total_triples_count, triples_count, triples_count_1;
+		Triple* triples_std = nullptr;
+		uint8_t* leaf_eq = nullptr;
+		int64_t total_triples_count, triples_count, triples_count_1;
 		sci::IKNP<sci::NetIO>* otInstance;
+		// Silent COTs for the leaf OTs and the AND triples, nullptr for IKNP
+		SILENTNS::FerretCOT<sci::NetIO>* ferret = nullptr;
 
-		Equality(int party, int bitlength, int log_radix_base, int num_cmps,
-			 IO* io, sci::OTPack<IO> *otpack) {
+		Equality(int party, int bitlength, int log_radix_base, int64_t num_cmps,
+			 IO* io, sci::OTPack<IO> *otpack, bool silent_ot = false) {
 			assert(log_radix_base <= 8);
 			assert(bitlength <= 64);
 			this->party = party;
@@ -64,6 +122,8 @@ template<typename IO> class Equality {
 			this->otpack = otpack;
 			this->otInstance = new sci::IKNP<sci::NetIO>(io);
 			this->triple_gen = new TripleGenerator<IO>(party, io, otpack);
+			if (silent_ot)
+				this->ferret = new SILENTNS::FerretCOT<sci::NetIO>(party, io, otInstance);
 			configure();
 		}
 
@@ -84,6 +144,22 @@ template<typename IO> class Equality {
 
 		~Equality() {
 			delete triple_gen;
+			delete ferret;
+			delete triples_std;
+			delete[] leaf_eq;
+		}
+
+		/*
+		 * Resizes the instance for the next chunk of n comparisons, keeping
+		 * the OT extension state so chunks run back to back on the same pipe.
+		 */
+		void set_num_cmps(int64_t n) {
+			if (n == num_cmps)
+				return;
+			num_cmps = n;
+			total_triples_count = num_triples*num_cmps;
+			delete triples_std;
+			this->triples_std = new Triple(num_triples*num_cmps, true);
 		}
 
 		void computeLeafOTs(uint64_t* data) {
@@ -94,6 +170,7 @@ template<typename IO> class Equality {
 			uint8_t* digits; // num_digits * num_cmps
 
 			digits = new uint8_t[num_digits*num_cmps];
+			delete[] leaf_eq;
 			leaf_eq = new uint8_t[num_digits*num_cmps];
 			/*std::cout<<"Some inputs inside are: "<<std::endl;
 			for(int i=0;i<10;i++)
@@ -102,7 +179,7 @@ template<typename IO> class Equality {
 
 			// Extract radix-digits from data
 			for(int i = 0; i < num_digits; i++) {// Stored from LSB to MSB
-				for(int j = 0; j < num_cmps; j++) {
+				for(int64_t j = 0; j < num_cmps; j++) {
 					if ((i == num_digits-1) && (r != 0))
 						digits[i*num_cmps+j] = (uint8_t)(data[j] >> i*beta) & mask_r;
 					else
@@ -121,7 +198,7 @@ template<typename IO> class Equality {
 			if(party == sci::ALICE) {
 				uint8_t** leaf_ot_messages; // (num_digits * num_cmps) X beta_pow (=2^beta)
 				leaf_ot_messages = new uint8_t*[num_digits*num_cmps];
-				for(int i = 0; i < num_digits*num_cmps; i++)
+				for(int64_t i = 0; i < num_digits*num_cmps; i++)
 					leaf_ot_messages[i] = new uint8_t[beta_pow];
 
 				clock_gettime(CLOCK_MONOTONIC, &lomstart);
@@ -129,7 +206,7 @@ template<typename IO> class Equality {
 				triple_gen->prg->random_bool((bool*)leaf_eq, num_digits*num_cmps);
 
 				for(int i = 0; i < num_digits; i++) {
-					for(int j = 0; j < num_cmps; j++) {
+					for(int64_t j = 0; j < num_cmps; j++) {
 						if (i == (num_digits - 1) && (r > 0)) {
 #ifdef WAN_EXEC
 							set_leaf_ot_messages(leaf_ot_messages[i*num_cmps+j], digits[i*num_cmps+j],
@@ -149,32 +226,10 @@ template<typename IO> class Equality {
 				clock_gettime(CLOCK_MONOTONIC, &locstart);
 
 				// Perform Leaf OTs
-				//cout<<"I am Sender in Leaf OT"<<endl;
-#ifdef WAN_EXEC
-				otpack->kkot_beta->send(leaf_ot_messages, num_cmps*(num_digits), 1);
-#else
-				if (r == 1) {
-					otpack->kkot_beta->send(leaf_ot_messages, num_cmps*(num_digits-1), 1);
-					otpack->iknp_straight->send(leaf_ot_messages+num_cmps*(num_digits-1), num_cmps, 1);
-				} 
-				else if (r != 0) {
-					otpack->kkot_beta->send(leaf_ot_messages, num_cmps*(num_digits-1), 1);
-					if(r == 2) {
-						otpack->kkot_4->send(leaf_ot_messages+num_cmps*(num_digits-1), num_cmps, 1);
-					} else if(r == 3) {
-						otpack->kkot_8->send(leaf_ot_messages+num_cmps*(num_digits-1), num_cmps, 1);
-					} else if(r == 4) {
-						otpack->kkot_16->send(leaf_ot_messages+num_cmps*(num_digits-1), num_cmps, 1);
-					} else {
-						throw std::invalid_argument("Not yet implemented!");
-					}
-				}
-				else {
-					otpack->kkot_beta->send(leaf_ot_messages, num_cmps*num_digits, 1);
-				}
-#endif
+				send_leaf_ots(leaf_ot_messages, num_digits, r);
+
 				// Cleanup
-				for(int i = 0; i < num_digits*num_cmps; i++)
+				for(int64_t i = 0; i < num_digits*num_cmps; i++)
 					delete[] leaf_ot_messages[i];
 				delete[] leaf_ot_messages;
 				clock_gettime(CLOCK_MONOTONIC, &locfinish);
@@ -189,34 +244,7 @@ template<typename IO> class Equality {
 			else {// party = sci::BOB
 				 //triple_gen->generate(3-party, triples_std, _16KKOT_to_4OT);
 				// Perform Leaf OTs
-				//cout<<"I am receiver in Leaf OT"<<endl;
-#ifdef WAN_EXEC
-				otpack->kkot_beta->recv(leaf_eq, digits, num_cmps*(num_digits), 1);
-#else
-				if (r == 1) {
-					otpack->kkot_beta->recv(leaf_eq, digits, num_cmps*(num_digits-1), 1);
-					otpack->iknp_straight->recv(leaf_eq+num_cmps*(num_digits-1),
-							digits+num_cmps*(num_digits-1), num_cmps, 1);
-				}
-				else if (r != 0) {
-					otpack->kkot_beta->recv(leaf_eq, digits, num_cmps*(num_digits-1), 1);
-					if(r == 2) {
-						otpack->kkot_4->recv(leaf_eq+num_cmps*(num_digits-1),
-								     digits+num_cmps*(num_digits-1), num_cmps, 1);
-					} else if(r == 3) {
-						otpack->kkot_8->recv(leaf_eq+num_cmps*(num_digits-1),
-								     digits+num_cmps*(num_digits-1), num_cmps, 1);
-					} else if(r == 4) {
-						otpack->kkot_16->recv(leaf_eq+num_cmps*(num_digits-1),
-								      digits+num_cmps*(num_digits-1), num_cmps, 1);
-					} else {
-						throw std::invalid_argument("Not yet implemented!");
-					}
-				}
-				else {
-					otpack->kkot_beta->recv(leaf_eq, digits, num_cmps*(num_digits), 1);
-				}
-#endif
+				recv_leaf_ots(digits, num_digits, r);
 
 				// Extract equality result from leaf_res_cmp
 				/*for(int i = 0; i < num_digits*num_cmps; i++) {
@@ -246,6 +274,88 @@ template<typename IO> class Equality {
 			delete[] digits;
 		}
 
+		/*
+		 * Leaf OTs for nd digits per comparison, where the most significant
+		 * digit has rr bits (rr == 0 when beta divides l).
+		 */
+		void send_leaf_ots(uint8_t** leaf_ot_messages, int nd, int rr) {
+			if (ferret != nullptr) {
+#ifndef WAN_EXEC
+				if (rr != 0) {
+					ferret->send_leaf_ots(leaf_ot_messages, num_cmps*(nd-1), beta);
+					ferret->send_leaf_ots(leaf_ot_messages+num_cmps*(nd-1), num_cmps, rr);
+					return;
+				}
+#endif
+				ferret->send_leaf_ots(leaf_ot_messages, num_cmps*nd, beta);
+				return;
+			}
+#ifdef WAN_EXEC
+			otpack->kkot_beta->send(leaf_ot_messages, num_cmps*(nd), 1);
+#else
+			if (rr == 1) {
+				otpack->kkot_beta->send(leaf_ot_messages, num_cmps*(nd-1), 1);
+				otpack->iknp_straight->send(leaf_ot_messages+num_cmps*(nd-1), num_cmps, 1);
+			} 
+			else if (rr != 0) {
+				otpack->kkot_beta->send(leaf_ot_messages, num_cmps*(nd-1), 1);
+				if(rr == 2) {
+					otpack->kkot_4->send(leaf_ot_messages+num_cmps*(nd-1), num_cmps, 1);
+				} else if(rr == 3) {
+					otpack->kkot_8->send(leaf_ot_messages+num_cmps*(nd-1), num_cmps, 1);
+				} else if(rr == 4) {
+					otpack->kkot_16->send(leaf_ot_messages+num_cmps*(nd-1), num_cmps, 1);
+				} else {
+					throw std::invalid_argument("Not yet implemented!");
+				}
+			}
+			else {
+				otpack->kkot_beta->send(leaf_ot_messages, num_cmps*nd, 1);
+			}
+#endif
+		}
+
+		void recv_leaf_ots(uint8_t* digits, int nd, int rr) {
+			if (ferret != nullptr) {
+#ifndef WAN_EXEC
+				if (rr != 0) {
+					ferret->recv_leaf_ots(leaf_eq, digits, num_cmps*(nd-1), beta);
+					ferret->recv_leaf_ots(leaf_eq+num_cmps*(nd-1), digits+num_cmps*(nd-1), num_cmps, rr);
+					return;
+				}
+#endif
+				ferret->recv_leaf_ots(leaf_eq, digits, num_cmps*nd, beta);
+				return;
+			}
+#ifdef WAN_EXEC
+			otpack->kkot_beta->recv(leaf_eq, digits, num_cmps*(nd), 1);
+#else
+			if (rr == 1) {
+				otpack->kkot_beta->recv(leaf_eq, digits, num_cmps*(nd-1), 1);
+				otpack->iknp_straight->recv(leaf_eq+num_cmps*(nd-1),
+						digits+num_cmps*(nd-1), num_cmps, 1);
+			}
+			else if (rr != 0) {
+				otpack->kkot_beta->recv(leaf_eq, digits, num_cmps*(nd-1), 1);
+				if(rr == 2) {
+					otpack->kkot_4->recv(leaf_eq+num_cmps*(nd-1),
+							     digits+num_cmps*(nd-1), num_cmps, 1);
+				} else if(rr == 3) {
+					otpack->kkot_8->recv(leaf_eq+num_cmps*(nd-1),
+							     digits+num_cmps*(nd-1), num_cmps, 1);
+				} else if(rr == 4) {
+					otpack->kkot_16->recv(leaf_eq+num_cmps*(nd-1),
+							      digits+num_cmps*(nd-1), num_cmps, 1);
+				} else {
+					throw std::invalid_argument("Not yet implemented!");
+				}
+			}
+			else {
+				otpack->kkot_beta->recv(leaf_eq, digits, num_cmps*(nd), 1);
+			}
+#endif
+		}
+
 		void set_leaf_ot_messages(uint8_t* ot_messages, uint8_t digit, int N,
 					  uint8_t mask_byte) {
 			for(int k = 0; k < N; k++) {
@@ -260,7 +370,10 @@ template<typename IO> class Equality {
 		void generate_triples() {
 			struct timespec start, finish;
 			clock_gettime(CLOCK_MONOTONIC, &start);
-			triple_gen->generate(party, triples_std, _16KKOT_to_4OT);
+			if (ferret != nullptr)
+				ferret->generate_bit_triples(triples_std->ai, triples_std->bi, triples_std->ci, num_triples*num_cmps);
+			else
+				triple_gen->generate(party, triples_std, _16KKOT_to_4OT);
 			clock_gettime(CLOCK_MONOTONIC, &finish);
 			double total_time = (finish.tv_sec - start.tv_sec);
 			total_time += (finish.tv_nsec - start.tv_nsec) / 1000000000.0;
@@ -281,116 +394,15 @@ template<typename IO> class Equality {
 
 			//clock_gettime(CLOCK_MONOTONIC, &start);
 			// Combine leaf OT results in a bottom-up fashion
-			uint8_t* ei = new uint8_t[(num_triples*num_cmps)/8];
-			uint8_t* fi = new uint8_t[(num_triples*num_cmps)/8];
-			uint8_t* e = new uint8_t[(num_triples*num_cmps)/8];
-			uint8_t* f = new uint8_t[(num_triples*num_cmps)/8];
+			// ei|fi and e|f of a level are kept contiguous so each is one message
+			uint8_t* eifi = new uint8_t[2*((num_triples*num_cmps)/8)];
+			uint8_t* ef = new uint8_t[2*((num_triples*num_cmps)/8)];
 			//std::cout<<"Size of auxes: "<< (num_triples*num_cmps)/8 <<std::endl;
 
-			int old_triple_count=0, triple_count=0;
+			int64_t old_triple_count=0, triple_count=0;
 
 			for(int i = 1; i < num_digits; i*=2) {
-				int counter=0;
-				for(int j = 0; j < num_digits and j+i < num_digits; j += 2*i) {
-					for(int m=0; m < num_cmps; m+=8) {
-						//std::cout<<"Comparison Number "<< m << std::endl;
-						/*if(m==0) {
-							std::cout<<"Let us check beaver triples"<<std::endl;
-							std::cout<<"a [j="<<j<<"]: "<<std::bitset<8>(triples_std->ai[(old_triple_count+ counter*num_cmps + m)/8])<<std::endl;
-							std::cout<<"b [j="<<j<<"]: "<<std::bitset<8>(triples_std->bi[(old_triple_count+ counter*num_cmps + m)/8])<<std::endl;
-							std::cout<<"c [j="<<j<<"]: "<<std::bitset<8>(triples_std->ci[(old_triple_count+ counter*num_cmps + m)/8])<<std::endl;
-						}*/
-						ei[(counter*num_cmps + m)/8] = triples_std->ai[(triple_count+ counter*num_cmps + m)/8];
-						fi[(counter*num_cmps + m)/8] = triples_std->bi[(triple_count+ counter*num_cmps + m)/8];
-						/*if(m==0) {
-							std::cout<<"ei [j="<<j<<"]: "<<std::bitset<8>(ei[(counter*num_cmps + m)/8])<<std::endl;
-							std::cout<<"fi [j="<<j<<"]: "<<std::bitset<8>(fi[(counter*num_cmps + m)/8])<<std::endl;
-						}*/
-						ei[(counter*num_cmps + m)/8] ^= sci::bool_to_uint8(leaf_eq + j*num_cmps + m, 8);
-						fi[(counter*num_cmps + m)/8] ^= sci::bool_to_uint8(leaf_eq + (j+i)*num_cmps + m, 8);
-						/*if(m==0) {
-							std::cout<<"ei [j="<<j<<"]: "<<std::bitset<8>(ei[(counter*num_cmps + m)/8])<<std::endl;
-							std::cout<<"fi [j="<<j<<"]: "<<std::bitset<8>(fi[(counter*num_cmps + m)/8])<<std::endl;
-						}*/
-					}
-					counter++;
-				}
-				triple_count += counter*num_cmps;
-				int comm_size = (counter*num_cmps)/8;
-				if(party == sci::ALICE) {
-					io->send_data(ei, comm_size);
-					io->send_data(fi, comm_size);
-					io->recv_data(e, comm_size);
-					io->recv_data(f, comm_size);
-				}
-				else {// party = sci::BOB
-					io->recv_data(e, comm_size);
-					io->recv_data(f, comm_size);
-					io->send_data(ei, comm_size);
-					io->send_data(fi, comm_size);
-				}
-
-				for(int i = 0; i < comm_size; i++) {
-					/*if(i%(num_cmps/8)==0) {
-						std::cout<<"e [j="<<i/(num_cmps/8)<<"]: "<<std::bitset<8>(e[i])<<std::endl;
-						std::cout<<"f [j="<<i/(num_cmps/8)<<"]: "<<std::bitset<8>(f[i])<<std::endl;
-
-						std::cout<<"ei [j="<<i/(num_cmps/8)<<"]: "<<std::bitset<8>(ei[i])<<std::endl;
-						std::cout<<"fi [j="<<i/(num_cmps/8)<<"]: "<<std::bitset<8>(fi[i])<<std::endl;
-					}*/
-					e[i] ^= ei[i];
-					f[i] ^= fi[i];
-					/*if(i%(num_cmps/8)==0) {
-						std::cout<<"e [j="<<i/(num_cmps/8)<<"]: "<<std::bitset<8>(e[i])<<std::endl;
-						std::cout<<"f [j="<<i/(num_cmps/8)<<"]: "<<std::bitset<8>(f[i])<<std::endl;
-					}*/
-				}
-
-				counter=0;
-				for(int j = 0; j < num_digits and j+i < num_digits; j += 2*i) {
-					for(int m=0; m < num_cmps; m+=8) {
-						uint8_t temp_z;
-						if (party == sci::ALICE)
-							temp_z = e[(counter*num_cmps + m)/8] & f[(counter*num_cmps + m)/8];
-						else
-							temp_z = 0;
-						/*if(m==0) {
-	 						 std::cout<<"temp_z [j="<<j<<"]: "<<std::bitset<8>(temp_z)<<std::endl;
-	 					 }*/
-
-						temp_z ^= f[(counter*num_cmps + m)/8] & triples_std->ai[(old_triple_count+ counter*num_cmps + m)/8];
-						/*if(m==0) {
-	 						 std::cout<<"temp_z [j="<<j<<"]: "<<std::bitset<8>(temp_z)<<std::endl;
-	 					 }*/
-						temp_z ^= e[(counter*num_cmps + m)/8] & triples_std->bi[(old_triple_count+ counter*num_cmps + m)/8];
-						/*if(m==0) {
-	 						 std::cout<<"temp_z [j="<<j<<"]: "<<std::bitset<8>(temp_z)<<std::endl;
-	 					 }*/
-						temp_z ^= triples_std->ci[(old_triple_count+ counter*num_cmps + m)/8];
-						/*if(m==0) {
-	 						 std::cout<<"temp_z [j="<<j<<"]: "<<std::bitset<8>(temp_z)<<std::endl;
-	 					 }*/
-
-						/*if(m==0) {
-							std::cout<<"Let us check beaver triples"<<std::endl;
-							std::cout<<"Triples Id: "<< (old_triple_count+ counter*num_cmps + m)/8 <<std::endl;
- 	 						std::cout<<"a [j="<<j<<"]: "<<std::bitset<8>(triples_std->ai[(old_triple_count+ counter*num_cmps + m)/8])<<std::endl;
-							std::cout<<"b [j="<<j<<"]: "<<std::bitset<8>(triples_std->bi[(old_triple_count+ counter*num_cmps + m)/8])<<std::endl;
-							std::cout<<"c [j="<<j<<"]: "<<std::bitset<8>(triples_std->ci[(old_triple_count+ counter*num_cmps + m)/8])<<std::endl;
- 	 					}*/
-						sci::uint8_to_bool(leaf_eq + j*num_cmps + m, temp_z, 8);
-					}
-					counter++;
-				}
-				/*std::cout<<"Some leaf ot messages: Level " << i<<std::endl;
-				for(int i=0; i<10; i++) {
-					for(int j=0; j<num_digits; j++) {
-						std::cout<< (int)leaf_eq[j*num_cmps+i]<<" ";
-					}
-					std::cout<<std::endl;
-				}
-				std::cout<<"+++++++++++++++"<<std::endl;*/
-				old_triple_count= triple_count;
+				AND_level(i, num_digits, triple_count, old_triple_count, eifi, ef);
 			}
 
 			clock_gettime(CLOCK_MONOTONIC, &finish);
@@ -400,19 +412,73 @@ template<typename IO> class Equality {
 
 			//std::cout<<"Some Outputs"<< std::endl;
 
-			for(int i=0; i<num_cmps; i++) {
+			for(int64_t i=0; i<num_cmps; i++) {
 				z[i]=leaf_eq[i];
 				//std::cout<<(int)leaf_eq[i]<<std::endl;
 			}
 
 			//cleanup
-			delete[] ei;
-			delete[] fi;
-			delete[] e;
-			delete[] f;
+			delete[] eifi;
+			delete[] ef;
 
 		}
 
+		/*
+		 * One level of the AND tree: combines the pairs (j, j+i) of the nd
+		 * per-digit equality bits of every comparison.
+		 */
+		void AND_level(int i, int nd, int64_t& triple_count, int64_t& old_triple_count,
+				uint8_t* eifi, uint8_t* ef) {
+			int num_pairs = (nd + i - 1)/(2*i);
+			int64_t comm_size = (num_pairs*num_cmps)/8;
+
+			for(int p = 0; p < num_pairs; p++)
+				AND_pair_open(2*i*p, i, p, triple_count, eifi, eifi + comm_size);
+			triple_count += num_pairs*num_cmps;
+			exchange_data(io, party, eifi, ef, 2*comm_size);
+
+			for(int64_t k = 0; k < 2*comm_size; k++)
+				ef[k] ^= eifi[k];
+
+			for(int p = 0; p < num_pairs; p++)
+				AND_pair_close(2*i*p, p, old_triple_count, ef, ef + comm_size);
+			old_triple_count = triple_count;
+		}
+
+		/*
+		 * Masks the equality bits of the digits j and j+i of every comparison
+		 * with the p-th block of triples of the level, which starts at triple
+		 * triple_off.
+		 */
+		void AND_pair_open(int j, int i, int p, int64_t triple_off, uint8_t* ei, uint8_t* fi) {
+			for(int64_t m = 0; m < num_cmps; m += 8) {
+				int64_t pos = (p*num_cmps + m)/8;
+				int64_t tpos = (triple_off + p*num_cmps + m)/8;
+				ei[pos] = triples_std->ai[tpos] ^ sci::bool_to_uint8(leaf_eq + j*num_cmps + m, 8);
+				fi[pos] = triples_std->bi[tpos] ^ sci::bool_to_uint8(leaf_eq + (j+i)*num_cmps + m, 8);
+			}
+		}
+
+		/*
+		 * Writes the AND of the pair opened by AND_pair_open over the equality
+		 * bits of digit j, from the opened e and f.
+		 */
+		void AND_pair_close(int j, int p, int64_t triple_off, const uint8_t* e, const uint8_t* f) {
+			for(int64_t m = 0; m < num_cmps; m += 8) {
+				int64_t pos = (p*num_cmps + m)/8;
+				int64_t tpos = (triple_off + p*num_cmps + m)/8;
+				uint8_t temp_z;
+				if (party == sci::ALICE)
+					temp_z = e[pos] & f[pos];
+				else
+					temp_z = 0;
+				temp_z ^= f[pos] & triples_std->ai[tpos];
+				temp_z ^= e[pos] & triples_std->bi[tpos];
+				temp_z ^= triples_std->ci[tpos];
+				sci::uint8_to_bool(leaf_eq + j*num_cmps + m, temp_z, 8);
+			}
+		}
+
 		/*
 		 * Evaluates a batch of 8 ANDs
 		 */
@@ -447,75 +513,240 @@ template<typename IO> class Equality {
 			}
 		}
 
-		void boolean_to_arithmetic(uint8_t* z, uint8_t* a_shares, const uint8_t smallmod) {
+		//ShareType is uint8_t for primes below 256 and uint16_t for larger ones
+		template<typename ShareType>
+		void boolean_to_arithmetic(uint8_t* z, ShareType* a_shares, const ShareType smallmod) {
 			//Get shares of 0/1 within a field defined by smallmod
-			/*for(int i=0; i<10; i++) {
-				cout<<" Share Boolean"<<i<<":"<<(int)z[i]<<endl;
-			}*/
-
-			int aux_val;
+			// ALICE: r + z_A mod p is sent on z_B, her share is z_A + 2r.
+			// BOB: receives r + z_A*z_B, his share is z_B - 2(r + z_A*z_B).
 			if(party ==sci::ALICE) {
-				uint8_t* aux_shares = (uint8_t *)malloc(sizeof(uint8_t)*num_cmps);
-				for(int i=0; i<num_cmps; i++)
-					aux_shares[i] = z[i];
-				otInstance->send_cot_moduloAdd<uint8_t>(a_shares, aux_shares, num_cmps, smallmod);
-				for(int i=0; i<num_cmps; i++) {
-						aux_val = -a_shares[i];
-						while (aux_val < 0) {
-							aux_val = aux_val + smallmod;
-						}
-						int tmp_share = ((int)z[i]) - 2*aux_val;
-						while(tmp_share < 0) {
-							tmp_share = tmp_share + smallmod;
-						}
-						//a_shares[i] = ((uint64_t)(((uint64_t)z[i]) - 2*aux_val));//  & ENCRYPTO::__61_bit_mask;
-						a_shares[i] = (uint8_t)tmp_share;
-						//a_shares[i] = (a_shares[i] & ENCRYPTO::__61_bit_mask) -1;
-				}
+				send_cot_moduloAdd(a_shares, z, smallmod);
+				sci::smallmod_b2a(a_shares, z, num_cmps, smallmod, false);
 			}
 			else {
-				//uint8_t* aux_shares = (uint8_t *)malloc(sizeof(uint8_t)*num_cmps);
-				otInstance->recv_cot_moduloAdd<uint8_t>(a_shares, z, num_cmps);
-				for(int i=0; i<num_cmps; i++) {
-					  int tmp_share = ((int)z[i]) - 2*a_shares[i];
-						while(tmp_share < 0) {
-							tmp_share = tmp_share + smallmod;
-						}
-						//a_shares[i] = ((uint64_t)(((uint64_t)z[i]) - 2*a_shares[i]));// & ENCRYPTO::__61_bit_mask;
-						a_shares[i] = (uint8_t)tmp_share;
-						//a_shares[i] = a_shares[i] & ENCRYPTO::__61_bit_mask;
+				otInstance->recv_cot_moduloAdd<ShareType>(a_shares, z, num_cmps);
+				sci::smallmod_b2a(a_shares, z, num_cmps, smallmod, true);
+			}
+		}
+
+		void send_cot_moduloAdd(uint8_t* a_shares, uint8_t* z, const uint8_t smallmod) {
+			otInstance->send_cot_moduloAdd<uint8_t>(a_shares, z, num_cmps, smallmod);
+		}
+
+		void send_cot_moduloAdd(uint16_t* a_shares, uint8_t* z, const uint16_t smallmod) {
+			//the correlation is as wide as the shares
+			std::vector<uint16_t> delta(z, z + num_cmps);
+			otInstance->send_cot_moduloAdd<uint16_t>(a_shares, delta.data(), num_cmps, smallmod);
+		}
+};
+
+/*
+ * Equality with the bit length L and radix 2^BETA fixed at compile time.
+ * Runs the same protocol as Equality. Digit extraction and the leaf OT
+ * messages use constant digit counts, masks and message counts, the AND
+ * tree is expanded level by level with a constant number of digit pairs per
+ * level, and the choice of the OT for the last digit is resolved statically.
+ * The loops over the comparisons of a chunk stay runtime loops.
+ */
+template<typename IO, int L, int BETA> class FixedEquality : public Equality<IO> {
+	public:
+		static constexpr int NUM_DIGITS = (L + BETA - 1)/BETA;
+		static constexpr int R = L % BETA;
+		static constexpr int BETA_POW = 1 << BETA;
+		static constexpr uint8_t MASK_BETA = (BETA == 8) ? 0xFF : ((1 << BETA) - 1);
+		static constexpr uint8_t MASK_R = (1 << R) - 1;
+#ifdef WAN_EXEC
+		static constexpr int LAST_POW = BETA_POW;
+#else
+		static constexpr int LAST_POW = (R > 0) ? (1 << R) : BETA_POW;
+#endif
+
+		static_assert(BETA <= 8 && L <= 64, "Unsupported equality parameters");
+#ifndef WAN_EXEC
+		static_assert(R <= 4, "Last digit must fit a 16-choose-1 OT");
+#endif
+
+		FixedEquality(int party, int64_t num_cmps, IO* io, sci::OTPack<IO>* otpack, bool silent_ot = false)
+			: Equality<IO>(party, L, BETA, num_cmps, io, otpack, silent_ot) {}
+
+		void computeLeafOTs(uint64_t* data) {
+			const int64_t num_cmps = this->num_cmps;
+			uint8_t* digits = new uint8_t[NUM_DIGITS*num_cmps];
+			delete[] this->leaf_eq;
+			this->leaf_eq = new uint8_t[NUM_DIGITS*num_cmps];
+
+			// Extract radix-digits from data, stored from LSB to MSB
+			for(int64_t j = 0; j < num_cmps; j++) {
+				uint64_t val = data[j];
+				for(int i = 0; i < NUM_DIGITS; i++) {
+					const uint8_t mask = ((i == NUM_DIGITS-1) && (R != 0)) ? (uint8_t)MASK_R : (uint8_t)MASK_BETA;
+					digits[i*num_cmps+j] = (uint8_t)(val >> (i*BETA)) & mask;
 				}
 			}
-			/*for(int i=0; i<10; i++) {
-				cout<<"1 Arithmetic Share "<<i<<":"<<(int)a_shares[i]<<endl;
-			}*/
+
+			if(this->party == sci::ALICE) {
+				uint8_t** leaf_ot_messages = new uint8_t*[NUM_DIGITS*num_cmps];
+				uint8_t* leaf_ot_buffer = new uint8_t[NUM_DIGITS*num_cmps*BETA_POW];
+				for(int64_t i = 0; i < NUM_DIGITS*num_cmps; i++)
+					leaf_ot_messages[i] = leaf_ot_buffer + i*BETA_POW;
+
+				this->triple_gen->prg->random_bool((bool*)this->leaf_eq, NUM_DIGITS*num_cmps);
+
+				for(int64_t i = 0; i < (NUM_DIGITS-1)*num_cmps; i++)
+					set_leaf_ot_messages<BETA_POW>(leaf_ot_messages[i], digits[i], this->leaf_eq[i]);
+				for(int64_t i = (NUM_DIGITS-1)*num_cmps; i < NUM_DIGITS*num_cmps; i++)
+					set_leaf_ot_messages<LAST_POW>(leaf_ot_messages[i], digits[i], this->leaf_eq[i]);
+
+				this->send_leaf_ots(leaf_ot_messages, NUM_DIGITS, R);
+
+				delete[] leaf_ot_buffer;
+				delete[] leaf_ot_messages;
+			}
+			else {// party = sci::BOB
+				this->recv_leaf_ots(digits, NUM_DIGITS, R);
+			}
+			delete[] digits;
+		}
+
+		template<int N>
+		static void set_leaf_ot_messages(uint8_t* ot_messages, uint8_t digit, uint8_t mask_byte) {
+			for(int k = 0; k < N; k++) {
+				ot_messages[k] = (digit == k) ^ mask_byte;
+			}
+		}
+
+		void traverse_and_compute_ANDs(uint8_t* z) {
+			const int64_t bytes = (this->num_triples*this->num_cmps)/8;
+			uint8_t* eifi = new uint8_t[2*bytes];
+			uint8_t* ef = new uint8_t[2*bytes];
+
+			int64_t old_triple_count=0, triple_count=0;
+			AND_levels<1>(triple_count, old_triple_count, eifi, ef,
+				      std::integral_constant<bool, (1 < NUM_DIGITS)>());
+
+			memcpy(z, this->leaf_eq, this->num_cmps);
+
+			delete[] eifi;
+			delete[] ef;
+		}
+
+	private:
+		template<int I>
+		void AND_levels(int64_t& triple_count, int64_t& old_triple_count, uint8_t* eifi, uint8_t* ef,
+				std::true_type) {
+			AND_level<I>(triple_count, old_triple_count, eifi, ef);
+			AND_levels<2*I>(triple_count, old_triple_count, eifi, ef,
+					std::integral_constant<bool, (2*I < NUM_DIGITS)>());
+		}
+
+		// Equality::AND_level with the level and the digit count as constants
+		template<int I>
+		void AND_level(int64_t& triple_count, int64_t& old_triple_count, uint8_t* eifi, uint8_t* ef) {
+			constexpr int NUM_PAIRS = (NUM_DIGITS + I - 1)/(2*I);
+			const int64_t comm_size = (NUM_PAIRS*this->num_cmps)/8;
+
+			for(int p = 0; p < NUM_PAIRS; p++)
+				this->AND_pair_open(2*I*p, I, p, triple_count, eifi, eifi + comm_size);
+			triple_count += NUM_PAIRS*this->num_cmps;
+			exchange_data(this->io, this->party, eifi, ef, 2*comm_size);
+
+			for(int64_t k = 0; k < 2*comm_size; k++)
+				ef[k] ^= eifi[k];
+
+			for(int p = 0; p < NUM_PAIRS; p++)
+				this->AND_pair_close(2*I*p, p, old_triple_count, ef, ef + comm_size);
+			old_triple_count = triple_count;
 		}
+
+		template<int I>
+		void AND_levels(int64_t&, int64_t&, uint8_t*, uint8_t*, std::false_type) {}
 };
 
-void equality_thread(int tid, int party, uint64_t* x, uint8_t* z, uint8_t* a_shares, int lnum_cmps, int l, int b, sci::NetIO* io, sci::OTPack<sci::NetIO>* otpack, const uint8_t smallmod) {
-	Equality<NetIO>* compare;
+/*
+ * Runs lnum_cmps comparisons in chunks of at most ENCRYPTO::equality_chunk_size through
+ * leaf OTs, triples, AND tree and B2A. The chunks share one instance, so the
+ * base OTs are set up once and the next chunk starts as soon as one is done.
+ */
+template<typename EqualityType, typename ShareType>
+void run_equality_chunks(EqualityType* compare, uint64_t* x, uint8_t* z, ShareType* a_shares, int64_t lnum_cmps,
+			 const ShareType smallmod) {
+	for(int64_t offset = 0; offset < lnum_cmps; offset += ENCRYPTO::equality_chunk_size) {
+		int64_t chunk = std::min<int64_t>(ENCRYPTO::equality_chunk_size, lnum_cmps - offset);
+		compare->set_num_cmps(chunk);
+		compare->computeLeafOTs(x+offset);
+		compare->generate_triples();
+		compare->traverse_and_compute_ANDs(z+offset);
+		compare->boolean_to_arithmetic(z+offset, a_shares+offset, smallmod);
+	}
+}
+
+template<typename ShareType>
+using equality_kernel_t = void (*)(int party, uint64_t* x, uint8_t* z, ShareType* a_shares, int64_t lnum_cmps,
+				   sci::NetIO* io, sci::OTPack<sci::NetIO>* otpack, const ShareType smallmod, bool silent_ot);
+
+template<int L, int BETA, typename ShareType>
+void fixed_equality_kernel(int party, uint64_t* x, uint8_t* z, ShareType* a_shares, int64_t lnum_cmps,
+			   sci::NetIO* io, sci::OTPack<sci::NetIO>* otpack, const ShareType smallmod, bool silent_ot) {
+	FixedEquality<NetIO, L, BETA> compare(party, std::min<int64_t>(lnum_cmps, ENCRYPTO::equality_chunk_size), io, otpack, silent_ot);
+	run_equality_chunks(&compare, x, z, a_shares, lnum_cmps, smallmod);
+}
+
+template<typename ShareType>
+struct EqualityKernelEntry {
+	int l;
+	int beta;
+	equality_kernel_t<ShareType> kernel;
+};
+
+// Configurations with a compile-time specialized kernel (l = 61, beta = 8
+// leaves a 5-bit last digit, which only the generic path reports)
+template<typename ShareType>
+equality_kernel_t<ShareType> find_equality_kernel(int l, int b) {
+	static const EqualityKernelEntry<ShareType> equality_kernels[] = {
+		{32, 2, fixed_equality_kernel<32, 2, ShareType>}, {32, 4, fixed_equality_kernel<32, 4, ShareType>},
+		{32, 8, fixed_equality_kernel<32, 8, ShareType>},
+		{40, 2, fixed_equality_kernel<40, 2, ShareType>}, {40, 4, fixed_equality_kernel<40, 4, ShareType>},
+		{40, 8, fixed_equality_kernel<40, 8, ShareType>},
+		{61, 2, fixed_equality_kernel<61, 2, ShareType>}, {61, 4, fixed_equality_kernel<61, 4, ShareType>},
+		{64, 2, fixed_equality_kernel<64, 2, ShareType>}, {64, 4, fixed_equality_kernel<64, 4, ShareType>},
+		{64, 8, fixed_equality_kernel<64, 8, ShareType>},
+	};
+	for(const EqualityKernelEntry<ShareType>& entry : equality_kernels) {
+		if(entry.l == l && entry.beta == b)
+			return entry.kernel;
+	}
+	return nullptr;
+}
+
+template<typename ShareType>
+void equality_thread(int tid, int party, uint64_t* x, uint8_t* z, ShareType* a_shares, int64_t lnum_cmps, int l, int b, sci::NetIO* io, sci::OTPack<sci::NetIO>* otpack, const ShareType smallmod, bool silent_ot) {
 	if(tid & 1) {
-		compare = new Equality<NetIO>(3-party, l, b, lnum_cmps, io, otpack);
-	} else {
-		compare = new Equality<NetIO>(party, l, b, lnum_cmps, io, otpack);
+		party = 3-party;
+	}
+	equality_kernel_t<ShareType> kernel = find_equality_kernel<ShareType>(l, b);
+	if(kernel != nullptr) {
+		kernel(party, x, z, a_shares, lnum_cmps, io, otpack, smallmod, silent_ot);
+		return;
 	}
+
+	// Generic path for parameters without a specialized kernel
+	Equality<NetIO>* compare = new Equality<NetIO>(party, l, b, std::min<int64_t>(lnum_cmps, ENCRYPTO::equality_chunk_size),
+							io, otpack, silent_ot);
 	//if(tid == 0) {
 	/*std::cout<<"Some inputs are: "<<std::endl;
 	for(int i=0;i<10;i++)
 	std::cout<<x[i]<<std::endl;
 	std::cout<<"+++++++++++++++++"<<std::endl;*/
-	compare->computeLeafOTs(x);
-	compare->generate_triples();
-
-	compare->traverse_and_compute_ANDs(z);
-	compare->boolean_to_arithmetic(z, a_shares, smallmod);
+	run_equality_chunks(compare, x, z, a_shares, lnum_cmps, smallmod);
 	//}
 	delete compare;
 	return;
 }
 
 
-void perform_equality(uint64_t* x, int party, int l, int b, int num_cmps, uint8_t* z, uint8_t* a_shares, sci::NetIO** ioArr, OTPack<sci::NetIO>** otpackArr, const uint8_t smallmod) {
+//a_shares receives the arithmetic shares of the results, of type uint8_t or uint16_t depending on the size of smallmod
+template<typename ShareType>
+void perform_equality(uint64_t* x, int party, int l, int b, int64_t num_cmps, uint8_t* z, ShareType* a_shares, sci::NetIO** ioArr, OTPack<sci::NetIO>** otpackArr, const ShareType smallmod, bool silent_ot) {
 	//std::cout<<"X Value: "<<x[5]<<std::endl;
 	//std::cout<<"B Value: "<<b<< std::endl;
 	uint64_t mask_l;
@@ -529,17 +760,17 @@ void perform_equality(uint64_t* x, int party, int l, int b, int num_cmps, uint8_
 	}*/
 
 	std::thread cmp_threads[2];
-	int chunk_size = (num_cmps/(8*2))*8;
+	int64_t chunk_size = (num_cmps/(8*2))*8;
 
 	for (int i = 0; i < 2; ++i) {
-		int offset = i*chunk_size;
-		int lnum_cmps;
+		int64_t offset = i*chunk_size;
+		int64_t lnum_cmps;
 		if (i == (2 - 1)) {
 			lnum_cmps = num_cmps - offset;
 		} else {
 			lnum_cmps = chunk_size;
 		}
-		cmp_threads[i] = std::thread(equality_thread, i, party, x+offset, z+offset, a_shares+offset, lnum_cmps, l, b, ioArr[i], otpackArr[i], smallmod);
+		cmp_threads[i] = std::thread(equality_thread<ShareType>, i, party, x+offset, z+offset, a_shares+offset, lnum_cmps, l, b, ioArr[i], otpackArr[i], smallmod, silent_ot);
 	}
 
 	for (int i = 0; i < 2; ++i) {
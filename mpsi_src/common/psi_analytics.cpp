@@ -332,6 +332,8 @@ void PrintTimings(const PsiAnalyticsContext &context) {
   std::cout << context.role << ": Time for transmission of the polynomials "
             << context.timings.polynomials_transmission << " ms\n";
   std::cout << context.role << ": Time for OPPRF " << context.timings.opprf << " ms\n";
+  std::cout << context.role << ": Time for MPC preprocessing (overlapped with OPPRF) "
+            << context.timings.preprocessing << " ms\n";
   std::cout << context.role << ": Time for circuit " << context.timings.circuit << " ms\n";
 
   std::cout << context.role << ": Total runtime: " << context.timings.total << "ms\n";
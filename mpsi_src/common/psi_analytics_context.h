@@ -43,7 +43,10 @@ struct PsiAnalyticsContext {
   double epsilon;
   uint64_t np;
   uint64_t radixparam;
-  uint8_t smallmod;
+  uint16_t smallmod;
+  uint64_t statsecparam;  //< statistical security parameter for the equality phase
+  uint64_t cmpbitlen;     //< bit-length compared in the equality phase
+  bool silentot;          //< use silent (Ferret) COTs in the equality phase
 
   uint64_t sentBytesOPRF;
   uint64_t recvBytesOPRF;
@@ -67,6 +70,9 @@ struct PsiAnalyticsContext {
   std::string genRandomSharesType;
   std::string multType;
   std::string verifyType;
+  std::string conversionType;  //< additive-to-threshold conversion of the circuit phase
+  std::string kingType;        //< party reconstructing the intermediate openings of the circuit phase
+  uint64_t packFactor;         //< bins packed per sharing in the circuit phase
   std::string partiesFile;
   std::string circuitFileName;
   std::string outputFileName;
@@ -104,6 +110,7 @@ struct PsiAnalyticsContext {
     //double aby_setup;
     //double aby_online;
     //double aby_total;
+    double preprocessing;
     double circuit;
     double total;
   } timings;
@@ -322,20 +322,35 @@ namespace RELAXEDNS {
 		//std::cout<<"Cp 3"<<context.radixparam<<": "<< context.bitlen<< std::endl;
 		for(std::uint64_t i=tid; i<context.np-1; i=i+context.nthreads) {
 			for(int j=0; j<2; j++) {
-				if (j == 0) {
-					otpackArr[2*i+j] = new OTPack<NetIO>(ioArr[2*i+j], 2, context.radixparam, context.bitlen);
+				//Silent OT only needs the IKNP base COTs set up inside Equality
+				if (context.silentot) {
+					otpackArr[2*i+j] = nullptr;
+				} else if (j == 0) {
+					otpackArr[2*i+j] = new OTPack<NetIO>(ioArr[2*i+j], 2, context.radixparam, context.cmpbitlen);
 				} else if (j == 1) {
-					otpackArr[2*i+j] = new OTPack<NetIO>(ioArr[2*i+j], 1, context.radixparam, context.bitlen);
+					otpackArr[2*i+j] = new OTPack<NetIO>(ioArr[2*i+j], 1, context.radixparam, context.cmpbitlen);
 				}
 			}
 		}
 	}
 
+	/*
+	 * Keep only the cmpbitlen low bits of every bin compared in the equality phase
+	 */
+	void TruncateBins(std::uint64_t *bins, std::uint64_t num_bins, std::uint64_t cmpbitlen) {
+		if(cmpbitlen >= 64)
+			return;
+		const std::uint64_t mask = (1ull << cmpbitlen) - 1;
+		for(std::uint64_t i=0; i<num_bins; i++)
+			bins[i] &= mask;
+	}
+
 	/*
 	 * Parallelise equality phase
 	 */
-	void multi_equality_thread(int tid, std::vector<std::vector<std::uint64_t>> &x, int party, int num_cmps, std::vector<std::vector<std::uint8_t>> &z,
-				   std::vector<std::vector<std::uint8_t>> &a_shares_bins, std::vector<std::vector<std::uint64_t>> &aux_bins,
+	template<typename ShareType>
+	void multi_equality_thread(int tid, std::vector<std::vector<std::uint64_t>> &x, int party, std::int64_t num_cmps, std::vector<std::vector<std::uint8_t>> &z,
+				   std::vector<std::vector<ShareType>> &a_shares_bins, std::vector<std::vector<std::uint64_t>> &aux_bins,
 				   std::vector<sci::NetIO*> &ioArr, std::vector<sci::OTPack<sci::NetIO>*> &otpackArr, ENCRYPTO::PsiAnalyticsContext &context,
 				   std::vector<std::unique_ptr<CSocket>> &allsocks) {
 		for(std::uint64_t i=tid; i<context.np-1; i=i+context.nthreads) {
@@ -345,8 +360,8 @@ namespace RELAXEDNS {
 				ioThreadArr[j] = ioArr[2*i+j];
 				otThreadpackArr[j] = otpackArr[2*i+j];
 			}
-			perform_equality(x[i].data(), party, context.bitlen, context.radixparam, num_cmps, z[i].data(),
-					 a_shares_bins[i].data(), ioThreadArr, otThreadpackArr, context.smallmod);
+			perform_equality(x[i].data(), party, context.cmpbitlen, context.radixparam, num_cmps, z[i].data(),
+					 a_shares_bins[i].data(), ioThreadArr, otThreadpackArr, (ShareType)context.smallmod, context.silentot);
 		}
 	}
 
@@ -405,13 +420,14 @@ namespace RELAXEDNS {
 	/*
 	 * Run relaxed batch OPPRF and equality check for all parties
 	 */
-	void run_threshold_relaxed_opprf(std::vector<std::vector<std::uint8_t>> &a_shares_bins, ENCRYPTO::PsiAnalyticsContext &context,
+	template<typename ShareType>
+	void run_threshold_relaxed_opprf(std::vector<std::vector<ShareType>> &a_shares_bins, ENCRYPTO::PsiAnalyticsContext &context,
 					 const std::vector<std::uint64_t> &inputs, std::vector<std::unique_ptr<CSocket>> &allsocks,
 					 std::vector<osuCrypto::Channel> &chls, std::vector<sci::NetIO*> &ioArr) {
-		int padded_size = ((context.nbins+7)/8)*8;
+		std::int64_t padded_size = ((context.nbins+7)/8)*8;
 
 		if (context.role == P_0) {//Protocol for leader party
-			a_shares_bins.resize(context.np-1, std::vector<std::uint8_t>(padded_size, 0));
+			a_shares_bins.resize(context.np-1, std::vector<ShareType>(padded_size, 0));
 
 			std::vector<std::vector<std::uint64_t>> sub_bins(context.np-1);
 			for(std::uint64_t i=0; i<context.np-1; i++) {
@@ -458,8 +474,9 @@ namespace RELAXEDNS {
 			}
 
 			for(std::uint64_t i=0; i<context.np-1; i++){
-				for(int j=context.nbins; j<padded_size; j++)
+				for(std::int64_t j=context.nbins; j<padded_size; j++)
 					sub_bins[i][j] = S_CONST;
+				TruncateBins(sub_bins[i].data(), padded_size, context.cmpbitlen);
 			}
 
 
@@ -472,7 +489,7 @@ namespace RELAXEDNS {
 			//Equality
 			std::thread equality_threads[context.nthreads];
 			for(std::uint64_t i=0; i<context.nthreads; i++) {
-				equality_threads[i] = std::thread(multi_equality_thread, i, std::ref(sub_bins), 2, padded_size, std::ref(res_bins),
+				equality_threads[i] = std::thread(multi_equality_thread<ShareType>, i, std::ref(sub_bins), 2, padded_size, std::ref(res_bins),
 								  std::ref(a_shares_bins), std::ref(aux_bins), std::ref(ioArr), std::ref(otpackArr),
 								  std::ref(context), std::ref(allsocks));
 			}
@@ -484,7 +501,7 @@ namespace RELAXEDNS {
 			context.timings.polynomials = phase_two_duration.count();
 
 		} else {//Protocol for non-leader parties
-			a_shares_bins.resize(1, std::vector<std::uint8_t>(padded_size, 0));
+			a_shares_bins.resize(1, std::vector<ShareType>(padded_size, 0));
 
 			//Hashing
 			auto simple_table_v = ENCRYPTO::simple_hash(context, inputs);
@@ -500,15 +517,18 @@ namespace RELAXEDNS {
 			//Equality
 			std::vector<sci::OTPack<sci::NetIO>*> otpackArr(2);
 			for(int j=0; j<2; j++) {
-				if (j == 0) {
-					otpackArr[j] = new OTPack<NetIO>(ioArr[j], 1, context.radixparam, context.bitlen);
+				if (context.silentot) {
+					otpackArr[j] = nullptr;
+				} else if (j == 0) {
+					otpackArr[j] = new OTPack<NetIO>(ioArr[j], 1, context.radixparam, context.cmpbitlen);
 				} else if (j == 1) {
-					otpackArr[j] = new OTPack<NetIO>(ioArr[j], 2, context.radixparam, context.bitlen);
+					otpackArr[j] = new OTPack<NetIO>(ioArr[j], 2, context.radixparam, context.cmpbitlen);
 				}
 			}
 
-			for(int j=context.nbins; j<padded_size; j++)
+			for(std::int64_t j=context.nbins; j<padded_size; j++)
 				actual_contents_of_bins[j] = C_CONST;
+			TruncateBins(actual_contents_of_bins.data(), padded_size, context.cmpbitlen);
 			std::vector<std::uint8_t> res_bins;
 			res_bins.resize(padded_size);
 
@@ -518,9 +538,16 @@ namespace RELAXEDNS {
 				ioThreadArr[j] = ioArr[j];
 				otThreadpackArr[j] = otpackArr[j];
 			}
-			perform_equality(actual_contents_of_bins.data(), 1, context.bitlen, context.radixparam, padded_size, res_bins.data(),
-					 a_shares_bins[0].data(), ioThreadArr, otThreadpackArr, context.smallmod);
+			perform_equality(actual_contents_of_bins.data(), 1, context.cmpbitlen, context.radixparam, padded_size, res_bins.data(),
+					 a_shares_bins[0].data(), ioThreadArr, otThreadpackArr, (ShareType)context.smallmod, context.silentot);
 		}
 	}
 
+	template void run_threshold_relaxed_opprf<std::uint8_t>(std::vector<std::vector<std::uint8_t>> &a_shares_bins, ENCRYPTO::PsiAnalyticsContext &context,
+								const std::vector<std::uint64_t> &inputs, std::vector<std::unique_ptr<CSocket>> &allsocks,
+								std::vector<osuCrypto::Channel> &chls, std::vector<sci::NetIO*> &ioArr);
+	template void run_threshold_relaxed_opprf<std::uint16_t>(std::vector<std::vector<std::uint16_t>> &a_shares_bins, ENCRYPTO::PsiAnalyticsContext &context,
+								 const std::vector<std::uint64_t> &inputs, std::vector<std::unique_ptr<CSocket>> &allsocks,
+								 std::vector<osuCrypto::Channel> &chls, std::vector<sci::NetIO*> &ioArr);
+
 }
@@ -49,7 +49,9 @@ namespace RELAXEDNS {
 			       std::vector<osuCrypto::Channel> &chls);
 
 	//Run OPPRF protocol for threshold PSI
-	void run_threshold_relaxed_opprf(std::vector<std::vector<std::uint8_t>> &sub_bins, ENCRYPTO::PsiAnalyticsContext &context, 
+	//The shares are uint8_t for a field modulus below 256 and uint16_t for a larger one
+	template<typename ShareType>
+	void run_threshold_relaxed_opprf(std::vector<std::vector<ShareType>> &sub_bins, ENCRYPTO::PsiAnalyticsContext &context, 
 					 const std::vector<std::uint64_t> &inputs, std::vector<std::unique_ptr<CSocket>> &allsocks, 
 					 std::vector<osuCrypto::Channel> &chls, std::vector<sci::NetIO*> &ioArr);
 
@@ -66,8 +68,11 @@ namespace RELAXEDNS {
 	void multi_otpack_setup(int tid, std::vector<sci::NetIO*> &ioArr, std::vector<sci::OTPack<sci::NetIO>*> &otpackArr, 
 				ENCRYPTO::PsiAnalyticsContext &context);
 
-	void multi_equality_thread(int tid, std::vector<std::vector<std::uint64_t>> &x, int party, int num_cmps, 
-				   std::vector<std::vector<std::uint8_t>> &z, std::vector<std::vector<std::uint8_t>> &a_shares_bins, 
+	void TruncateBins(std::uint64_t *bins, std::uint64_t num_bins, std::uint64_t cmpbitlen);
+
+	template<typename ShareType>
+	void multi_equality_thread(int tid, std::vector<std::vector<std::uint64_t>> &x, int party, std::int64_t num_cmps, 
+				   std::vector<std::vector<std::uint8_t>> &z, std::vector<std::vector<ShareType>> &a_shares_bins, 
 				   std::vector<std::vector<std::uint64_t>> &aux_bins, std::vector<sci::NetIO*> &ioArr, 
 				   std::vector<sci::OTPack<sci::NetIO>*> &otpackArr, ENCRYPTO::PsiAnalyticsContext &context, 
 				   std::vector<std::unique_ptr<CSocket>> &allsocks);
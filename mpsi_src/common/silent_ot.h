@@ -0,0 +1,448 @@
+/*
+ *  \copyright the MIT License. Copyright (c) 2021 Microsoft Research
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining
+ *  a copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the Software
+ *  is furnished to do so, subject to the following conditions:
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ *  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR
+ *  A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ *  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ *  CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ *  OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef SILENT_OT_H__
+#define SILENT_OT_H__
+#include "EzPC/SCI/src/OT/emp-ot.h"
+#include "EzPC/SCI/src/utils/emp-tool.h"
+#include <immintrin.h>
+#include <vector>
+
+/*
+ * Silent correlated OT in the style of Ferret (Yang et al., CCS 2020), for
+ * semi-honest parties. A batch of N random COTs is obtained from K + T*H
+ * base COTs: T GGM trees of depth H give a regular-noise multi-point COT,
+ * which is compressed with a local linear code of weight LPN_D over the K
+ * base COTs. The first batch is bootstrapped with IKNP, later batches reuse
+ * the last K + T*H outputs of the previous one.
+ *
+ * The sender (ALICE) holds Delta; for every COT it gets a block k and the
+ * receiver (BOB) gets a random bit b and the block k ^ b*Delta.
+ */
+
+namespace SILENTNS {
+
+// Parameters of the bootstrapping instance of Ferret, 128-bit security
+constexpr int64_t FERRET_N = 470016;
+constexpr int64_t FERRET_K = 32768;
+constexpr int64_t FERRET_T = 918;
+constexpr int FERRET_H = 9;
+constexpr int LPN_D = 10;
+constexpr int64_t FERRET_RESERVE = FERRET_K + FERRET_T*FERRET_H;
+
+// Leaf OTs and bit triples handled per round, bounding the COTs held at once
+// (at most 2^18*8 blocks, 32 MiB, for the leaf OTs and 2^21 blocks for the triples)
+constexpr int64_t LEAF_OT_BATCH = 1 << 18;
+constexpr int64_t TRIPLE_BATCH = 1 << 20;
+
+/*
+ * Fixed-key AES-128 with AES-NI, used as the random permutation for the
+ * GGM trees, the correlation robust hash and the public LPN matrix.
+ */
+class FixedKeyAES {
+	public:
+		__m128i rk[11];
+
+		explicit FixedKeyAES(__m128i key) {
+#define AES_EXPAND(i, rcon) rk[i] = expand(rk[i-1], _mm_aeskeygenassist_si128(rk[i-1], rcon))
+			rk[0] = key;
+			AES_EXPAND(1, 0x01); AES_EXPAND(2, 0x02); AES_EXPAND(3, 0x04); AES_EXPAND(4, 0x08);
+			AES_EXPAND(5, 0x10); AES_EXPAND(6, 0x20); AES_EXPAND(7, 0x40); AES_EXPAND(8, 0x80);
+			AES_EXPAND(9, 0x1b); AES_EXPAND(10, 0x36);
+#undef AES_EXPAND
+		}
+
+		inline __m128i encrypt(__m128i x) const {
+			x = _mm_xor_si128(x, rk[0]);
+			for(int r = 1; r < 10; r++)
+				x = _mm_aesenc_si128(x, rk[r]);
+			return _mm_aesenclast_si128(x, rk[10]);
+		}
+
+		// Encrypts n blocks in place, 8 at a time to keep the AES units busy
+		void encrypt(__m128i* x, int64_t n) const {
+			int64_t i = 0;
+			for(; i + 8 <= n; i += 8) {
+				__m128i b[8];
+				for(int j = 0; j < 8; j++)
+					b[j] = _mm_xor_si128(x[i+j], rk[0]);
+				for(int r = 1; r < 10; r++)
+					for(int j = 0; j < 8; j++)
+						b[j] = _mm_aesenc_si128(b[j], rk[r]);
+				for(int j = 0; j < 8; j++)
+					x[i+j] = _mm_aesenclast_si128(b[j], rk[10]);
+			}
+			for(; i < n; i++)
+				x[i] = encrypt(x[i]);
+		}
+
+	private:
+		static inline __m128i expand(__m128i key, __m128i keygened) {
+			keygened = _mm_shuffle_epi32(keygened, _MM_SHUFFLE(3,3,3,3));
+			key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+			key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+			key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+			return _mm_xor_si128(key, keygened);
+		}
+};
+
+inline bool block_lsb(__m128i x) {
+	return _mm_cvtsi128_si64(x) & 1;
+}
+
+/*
+ * Tweakable correlation robust hash H(x, i) = pi(sigma(x) ^ i) ^ sigma(x) ^ i
+ * with sigma(xL || xR) = (xL ^ xR || xL), safe for inputs related by Delta.
+ */
+class CCRHash {
+	public:
+		FixedKeyAES pi;
+
+		CCRHash() : pi(_mm_set_epi64x(0x2b7e151628aed2a6ULL, 0xabf7158809cf4f3cULL)) {}
+
+		static inline __m128i sigma(__m128i x) {
+			return _mm_xor_si128(_mm_shuffle_epi32(x, 78), _mm_and_si128(x, _mm_set_epi64x(-1, 0)));
+		}
+
+		inline __m128i H(__m128i x, uint64_t tweak) const {
+			__m128i y = _mm_xor_si128(sigma(x), _mm_set_epi64x(0, tweak));
+			return _mm_xor_si128(pi.encrypt(y), y);
+		}
+};
+
+template<typename IO> class FerretCOT {
+	public:
+		int party;
+		IO* io;
+		sci::IKNP<IO>* base_ot;
+		__m128i Delta;
+		CCRHash ccrh;
+		uint64_t hash_ctr = 0;
+
+		FerretCOT(int party, IO* io, sci::IKNP<IO>* base_ot)
+			: party(party), io(io), base_ot(base_ot),
+			  prg_left(_mm_set_epi64x(0x0123456789abcdefULL, 0x0f1e2d3c4b5a6978ULL)),
+			  prg_right(_mm_set_epi64x(0x13198a2e03707344ULL, 0xa4093822299f31d0ULL)),
+			  lpn_aes(_mm_set_epi64x(0x243f6a8885a308d3ULL, 0x452821e638d01377ULL)) {
+			if(party == sci::ALICE) {
+				prg.random_data(&Delta, sizeof(__m128i));
+				Delta = _mm_or_si128(Delta, _mm_set_epi64x(0, 1));
+			} else {
+				Delta = _mm_setzero_si128();
+			}
+		}
+
+		/*
+		 * Next length random COTs. Sender: data[i] = k_i. Receiver:
+		 * data[i] = k_i ^ choice[i]*Delta with uniformly random choice[i].
+		 */
+		void rcot(__m128i* data, uint8_t* choice, int64_t length) {
+			int64_t done = 0;
+			while(done < length) {
+				// The last FERRET_RESERVE COTs of a batch seed the next one
+				if(buf.empty() || buf_used == FERRET_N - FERRET_RESERVE)
+					extend();
+				int64_t n = std::min(length - done, FERRET_N - FERRET_RESERVE - buf_used);
+				memcpy(data + done, buf.data() + buf_used, n*sizeof(__m128i));
+				if(party != sci::ALICE)
+					memcpy(choice + done, buf_choice.data() + buf_used, n);
+				buf_used += n;
+				done += n;
+			}
+		}
+
+		/*
+		 * num random bit triples, packed 8 per byte as in sci::Triple. Two
+		 * COTs give the two cross terms: the sender's bits are the XOR of its
+		 * two hashed messages, the receiver's bits are its choice bits.
+		 */
+		void generate_bit_triples(uint8_t* ai, uint8_t* bi, uint8_t* ci, int64_t num) {
+			assert(num % 8 == 0);
+			for(int64_t done = 0; done < num; done += TRIPLE_BATCH) {
+				int64_t n = std::min(TRIPLE_BATCH, num - done);
+				generate_bit_triples_batch(ai + done/8, bi + done/8, ci + done/8, n);
+			}
+		}
+
+		/*
+		 * num 1-out-of-2^logN OTs of single bits, msgs[i][0..2^logN) in {0,1}.
+		 * Each OT uses logN random COTs as key pairs (Naor-Pinkas); the
+		 * receiver derandomizes with logN bits and the sender masks all 2^logN
+		 * messages with the hash of the XOR of the keys along their index.
+		 * Runs in rounds of LEAF_OT_BATCH OTs.
+		 */
+		void send_leaf_ots(uint8_t** msgs, int64_t num, int logN) {
+			for(int64_t done = 0; done < num; done += LEAF_OT_BATCH)
+				send_leaf_ots_batch(msgs + done, std::min(LEAF_OT_BATCH, num - done), logN);
+		}
+
+		void recv_leaf_ots(uint8_t* out, const uint8_t* choices, int64_t num, int logN) {
+			for(int64_t done = 0; done < num; done += LEAF_OT_BATCH)
+				recv_leaf_ots_batch(out + done, choices + done, std::min(LEAF_OT_BATCH, num - done), logN);
+		}
+
+	private:
+		sci::PRG128 prg;
+		FixedKeyAES prg_left, prg_right, lpn_aes;
+		std::vector<__m128i> buf;
+		std::vector<uint8_t> buf_choice;
+		int64_t buf_used = 0;
+
+		void generate_bit_triples_batch(uint8_t* ai, uint8_t* bi, uint8_t* ci, int64_t num) {
+			std::vector<__m128i> cot(2*num);
+			std::vector<uint8_t> choice(party == sci::ALICE ? 0 : 2*num);
+			rcot(cot.data(), choice.data(), 2*num);
+			for(int64_t i = 0; i < num/8; i++) {
+				uint8_t a = 0, b = 0, c = 0;
+				for(int k = 0; k < 8; k++) {
+					int64_t t = 8*i + k;
+					uint64_t tweak = hash_ctr + 2*t;
+					uint8_t x, y, s;
+					if(party == sci::ALICE) {
+						// x = a_A, y = b_A, s = share of a_A*b_B ^ b_A*a_B
+						uint8_t m0 = block_lsb(ccrh.H(cot[2*t], tweak));
+						uint8_t m1 = block_lsb(ccrh.H(_mm_xor_si128(cot[2*t], Delta), tweak));
+						uint8_t n0 = block_lsb(ccrh.H(cot[2*t+1], tweak+1));
+						uint8_t n1 = block_lsb(ccrh.H(_mm_xor_si128(cot[2*t+1], Delta), tweak+1));
+						x = m0 ^ m1;
+						y = n0 ^ n1;
+						s = m0 ^ n0;
+					} else {
+						// x = a_B, y = b_B
+						y = choice[2*t];
+						x = choice[2*t+1];
+						s = block_lsb(ccrh.H(cot[2*t], tweak)) ^ block_lsb(ccrh.H(cot[2*t+1], tweak+1));
+					}
+					a |= x << k;
+					b |= y << k;
+					c |= ((x & y) ^ s) << k;
+				}
+				ai[i] = a;
+				bi[i] = b;
+				ci[i] = c;
+			}
+			hash_ctr += 2*num;
+		}
+
+		void send_leaf_ots_batch(uint8_t** msgs, int64_t num, int logN) {
+			const int N = 1 << logN;
+			std::vector<__m128i> cot(num*logN);
+			rcot(cot.data(), nullptr, num*logN);
+			std::vector<uint8_t> flips((num*logN + 7)/8);
+			io->recv_data(flips.data(), flips.size());
+			std::vector<uint8_t> masked((num*N + 7)/8, 0);
+			std::vector<__m128i> key0(logN), key1(logN);
+			// The key hashes use the first num*logN tweaks, the pads the next num*N
+			const uint64_t pad_ctr = hash_ctr + num*logN;
+			for(int64_t i = 0; i < num; i++) {
+				for(int j = 0; j < logN; j++) {
+					int64_t idx = i*logN + j;
+					uint64_t tweak = hash_ctr + idx;
+					__m128i k0 = ccrh.H(cot[idx], tweak);
+					__m128i k1 = ccrh.H(_mm_xor_si128(cot[idx], Delta), tweak);
+					if((flips[idx/8] >> (idx%8)) & 1)
+						std::swap(k0, k1);
+					key0[j] = k0;
+					key1[j] = k1;
+				}
+				for(int m = 0; m < N; m++) {
+					__m128i key = _mm_setzero_si128();
+					for(int j = 0; j < logN; j++)
+						key = _mm_xor_si128(key, ((m >> j) & 1) ? key1[j] : key0[j]);
+					uint8_t bit = msgs[i][m] ^ block_lsb(ccrh.H(key, pad_ctr + i*N + m));
+					masked[(i*N + m)/8] |= bit << ((i*N + m)%8);
+				}
+			}
+			io->send_data(masked.data(), masked.size());
+			hash_ctr += num*logN + num*N;
+		}
+
+		void recv_leaf_ots_batch(uint8_t* out, const uint8_t* choices, int64_t num, int logN) {
+			const int N = 1 << logN;
+			std::vector<__m128i> cot(num*logN);
+			std::vector<uint8_t> rand_choice(num*logN);
+			rcot(cot.data(), rand_choice.data(), num*logN);
+			std::vector<uint8_t> flips((num*logN + 7)/8, 0);
+			for(int64_t i = 0; i < num; i++) {
+				for(int j = 0; j < logN; j++) {
+					int64_t idx = i*logN + j;
+					uint8_t flip = ((choices[i] >> j) & 1) ^ rand_choice[idx];
+					flips[idx/8] |= flip << (idx%8);
+				}
+			}
+			io->send_data(flips.data(), flips.size());
+			std::vector<uint8_t> masked((num*N + 7)/8);
+			io->recv_data(masked.data(), masked.size());
+			const uint64_t pad_ctr = hash_ctr + num*logN;
+			for(int64_t i = 0; i < num; i++) {
+				__m128i key = _mm_setzero_si128();
+				for(int j = 0; j < logN; j++) {
+					int64_t idx = i*logN + j;
+					key = _mm_xor_si128(key, ccrh.H(cot[idx], hash_ctr + idx));
+				}
+				int64_t pos = i*N + choices[i];
+				out[i] = ((masked[pos/8] >> (pos%8)) & 1) ^ block_lsb(ccrh.H(key, pad_ctr + pos));
+			}
+			hash_ctr += num*logN + num*N;
+		}
+
+		// GGM length doubling PRG
+		inline void ggm_expand(__m128i seed, __m128i& left, __m128i& right) const {
+			left = _mm_xor_si128(prg_left.encrypt(seed), seed);
+			right = _mm_xor_si128(prg_right.encrypt(seed), seed);
+		}
+
+		/*
+		 * Produces a fresh batch of FERRET_N COTs in buf, keeping its last
+		 * FERRET_RESERVE entries aside as the base COTs of the next batch.
+		 */
+		void extend() {
+			std::vector<__m128i> base(FERRET_RESERVE);
+			std::vector<uint8_t> base_choice(party == sci::ALICE ? 0 : FERRET_RESERVE);
+			if(buf.empty()) {
+				if(party == sci::ALICE) {
+					base_ot->send_cot((sci::block128*)base.data(), Delta, FERRET_RESERVE);
+				} else {
+					prg.random_bool((bool*)base_choice.data(), FERRET_RESERVE);
+					base_ot->recv_cot((sci::block128*)base.data(), (bool*)base_choice.data(), FERRET_RESERVE);
+				}
+			} else {
+				memcpy(base.data(), buf.data() + FERRET_N - FERRET_RESERVE, FERRET_RESERVE*sizeof(__m128i));
+				if(party != sci::ALICE)
+					memcpy(base_choice.data(), buf_choice.data() + FERRET_N - FERRET_RESERVE, FERRET_RESERVE);
+			}
+
+			std::vector<__m128i> out(FERRET_N);
+			std::vector<uint8_t> out_choice(party == sci::ALICE ? 0 : FERRET_N, 0);
+			mpcot(out.data(), out_choice.data(), base.data() + FERRET_K,
+			      party == sci::ALICE ? nullptr : base_choice.data() + FERRET_K);
+			lpn_encode(out.data(), out_choice.data(), base.data(),
+				   party == sci::ALICE ? nullptr : base_choice.data());
+
+			buf.swap(out);
+			buf_choice.swap(out_choice);
+			buf_used = 0;
+		}
+
+		/*
+		 * Regular-noise multi-point COT: FERRET_T single-point COTs over
+		 * blocks of 2^FERRET_H, one base COT per tree level. The receiver's
+		 * random base choice bits fix the punctured point, alpha_l = !b_l.
+		 */
+		void mpcot(__m128i* out, uint8_t* out_choice, const __m128i* base, const uint8_t* base_choice) {
+			const int64_t leaves = 1LL << FERRET_H;
+			std::vector<__m128i> msgs(FERRET_T*(2*FERRET_H + 1));
+			if(party == sci::ALICE) {
+				std::vector<__m128i> seeds(FERRET_T);
+				prg.random_data(seeds.data(), FERRET_T*sizeof(__m128i));
+				for(int64_t t = 0; t < FERRET_T; t++) {
+					__m128i* v = out + t*leaves;
+					__m128i* c = msgs.data() + t*(2*FERRET_H + 1);
+					v[0] = seeds[t];
+					for(int l = 0; l < FERRET_H; l++) {
+						__m128i K0 = _mm_setzero_si128(), K1 = _mm_setzero_si128();
+						for(int64_t j = (1LL << l) - 1; j >= 0; j--) {
+							__m128i left, right;
+							ggm_expand(v[j], left, right);
+							v[2*j] = left;
+							v[2*j+1] = right;
+							K0 = _mm_xor_si128(K0, left);
+							K1 = _mm_xor_si128(K1, right);
+						}
+						const __m128i q = base[t*FERRET_H + l];
+						const uint64_t tweak = hash_ctr + t*FERRET_H + l;
+						c[2*l] = _mm_xor_si128(ccrh.H(q, tweak), K0);
+						c[2*l+1] = _mm_xor_si128(ccrh.H(_mm_xor_si128(q, Delta), tweak), K1);
+					}
+					__m128i d = Delta;
+					for(int64_t j = 0; j < leaves; j++)
+						d = _mm_xor_si128(d, v[j]);
+					c[2*FERRET_H] = d;
+				}
+				io->send_data(msgs.data(), msgs.size()*sizeof(__m128i));
+			} else {
+				io->recv_data(msgs.data(), msgs.size()*sizeof(__m128i));
+				for(int64_t t = 0; t < FERRET_T; t++) {
+					__m128i* w = out + t*leaves;
+					const __m128i* c = msgs.data() + t*(2*FERRET_H + 1);
+					int64_t alpha = 0;
+					w[0] = _mm_setzero_si128();
+					for(int l = 0; l < FERRET_H; l++) {
+						// alpha is the path prefix of length l, its node is unknown
+						for(int64_t j = (1LL << l) - 1; j >= 0; j--) {
+							if(j == alpha) {
+								w[2*j] = w[2*j+1] = _mm_setzero_si128();
+								continue;
+							}
+							ggm_expand(w[j], w[2*j], w[2*j+1]);
+						}
+						const uint8_t b = base_choice[t*FERRET_H + l];
+						const uint64_t tweak = hash_ctr + t*FERRET_H + l;
+						__m128i sib = _mm_xor_si128(c[2*l + b], ccrh.H(base[t*FERRET_H + l], tweak));
+						for(int64_t j = b; j < (2LL << l); j += 2)
+							sib = _mm_xor_si128(sib, w[j]);
+						alpha = 2*alpha + (1 - b);
+						w[2*(alpha >> 1) + b] = sib;
+					}
+					__m128i d = c[2*FERRET_H];
+					for(int64_t j = 0; j < leaves; j++)
+						d = _mm_xor_si128(d, w[j]);
+					w[alpha] = d;
+					out_choice[t*leaves + alpha] = 1;
+				}
+			}
+			hash_ctr += FERRET_T*FERRET_H;
+		}
+
+		/*
+		 * out[i] ^= XOR of LPN_D base COTs at public pseudo-random positions,
+		 * the same positions for both parties.
+		 */
+		void lpn_encode(__m128i* out, uint8_t* out_choice, const __m128i* base, const uint8_t* base_choice) {
+			const int blocks_per_row = (LPN_D + 3)/4;
+			std::vector<__m128i> idx(64*blocks_per_row);
+			for(int64_t i = 0; i < FERRET_N; i += 64) {
+				int64_t rows = std::min((int64_t)64, FERRET_N - i);
+				for(int64_t j = 0; j < rows*blocks_per_row; j++)
+					idx[j] = _mm_set_epi64x(lpn_ctr, i*blocks_per_row + j);
+				lpn_aes.encrypt(idx.data(), rows*blocks_per_row);
+				for(int64_t r = 0; r < rows; r++) {
+					const uint32_t* pos = (const uint32_t*)(idx.data() + r*blocks_per_row);
+					__m128i acc = out[i+r];
+					uint8_t bit = 0;
+					for(int d = 0; d < LPN_D; d++) {
+						uint32_t p = pos[d] % FERRET_K;
+						acc = _mm_xor_si128(acc, base[p]);
+						if(base_choice != nullptr)
+							bit ^= base_choice[p];
+					}
+					out[i+r] = acc;
+					if(base_choice != nullptr)
+						out_choice[i+r] ^= bit;
+				}
+			}
+			lpn_ctr++;
+		}
+
+		uint64_t lpn_ctr = 0;
+};
+
+}
+#endif //SILENT_OT_H__
@@ -41,6 +41,7 @@
 #include "MPCHonestMajority/CircuitPSI.h"
 #include "MPCHonestMajority/ZpKaratsubaElement.h"
 #include "MPCHonestMajority/ZpMersenneByteElement.h"
+#include "MPCHonestMajority/ZpMersenneShortElement.h"
 #include <smmintrin.h>
 #include <inttypes.h>
 #include <stdio.h>
@@ -63,6 +64,7 @@ auto read_test_options(int32_t argcp, char **argvp) {
 	po::options_description allowed("Allowed options");
 	std::string type;
 	std::string opprf_type;
+	bool adaptive_bitlen;
 
 	// clang-format off
 
@@ -80,7 +82,14 @@ auto read_test_options(int32_t argcp, char **argvp) {
 		("file_address,F",    po::value<decltype(context.file_address)>(&context.file_address)->default_value("../../files/addresses"),                         "IP Addresses")
 		("type,y",         po::value<std::string>(&type)->default_value("PSI"),                                          "Function type {None, PSI, Threshold, Circuit}")
 		("opprf_type,o",         po::value<std::string>(&opprf_type)->default_value("Poly"),                                          "OPPRF type {Poly, Relaxed}")
-		("radixparam,R",     po::value<decltype(context.radixparam)>(&context.radixparam)->default_value(4u),       "Radix Parameter, default: 4");
+		("radixparam,R",     po::value<decltype(context.radixparam)>(&context.radixparam)->default_value(4u),       "Radix Parameter, default: 4")
+		("adaptive-bitlen,a",  po::bool_switch(&adaptive_bitlen)->default_value(false),                                "Compare only the bits needed for statistical correctness in the equality phase")
+		("silent-ot,S",    po::bool_switch(&context.silentot)->default_value(false),                                     "Use silent (Ferret) correlated OTs for the equality phase")
+		("statsec,s",      po::value<decltype(context.statsecparam)>(&context.statsecparam)->default_value(40u),           "Statistical security parameter for the adaptive bit-length, default: 40")
+		("conversion,x",   po::value<std::string>(&context.conversionType)->default_value("Leader"),                     "Additive-to-threshold conversion {Leader, Direct}")
+		("randomshares,g", po::value<std::string>(&context.genRandomSharesType)->default_value("HIM"),                   "Generation of the circuit's random sharings {HIM, PRSS}")
+		("king,k",         po::value<std::string>(&context.kingType)->default_value("Leader"),                           "Reconstruction of the circuit's intermediate openings {Leader (P0), Rotate (by bin range)}")
+		("pack,P",         po::value<decltype(context.packFactor)>(&context.packFactor)->default_value(1u),                "Bins packed per sharing in the circuit, tolerating T-P+1 instead of T corruptions, default: 1");
 
 	// clang-format on
 
@@ -121,6 +130,44 @@ auto read_test_options(int32_t argcp, char **argvp) {
 		throw std::runtime_error(error_msg.c_str());
 	}
 
+	//Setting additive-to-threshold conversion of the circuit phase
+	if (context.conversionType.compare("Leader") != 0 && context.conversionType.compare("Direct") != 0) {
+		std::string error_msg(std::string("Unknown conversion type: " + context.conversionType));
+		throw std::runtime_error(error_msg.c_str());
+	}
+
+	//Setting the king of the circuit phase
+	//With Rotate every party reconstructs a range of the bins, the final output is still opened at P0
+	if (context.kingType.compare("Leader") != 0 && context.kingType.compare("Rotate") != 0) {
+		std::string error_msg(std::string("Unknown king type: " + context.kingType));
+		throw std::runtime_error(error_msg.c_str());
+	}
+
+	//Setting packed sharing of the circuit phase
+	//The sharings keep degree T = ceil(N/2)-1 and hide the P packed bins from up to T-P+1 parties
+	if (context.packFactor < 1) {
+		throw std::runtime_error("The packing factor must be at least 1.");
+	}
+	if (context.packFactor > 1) {
+		uint64_t t = (context.np + 1) / 2 - 1;
+		if (context.packFactor > t) {
+			std::string error_msg("The packing factor must be between 1 and " + std::to_string(t) + ".");
+			throw std::runtime_error(error_msg.c_str());
+		}
+		std::cout << "Packing " << context.packFactor << " bins per sharing: the circuit phase is private against "
+			  << t - context.packFactor + 1 << " instead of " << t << " corrupted parties" << std::endl;
+	}
+
+	//Setting random sharing generation of the circuit phase
+	//PRSS needs one key per subset of N-T parties, so it is limited to small N
+	if (context.genRandomSharesType.compare("HIM") != 0 && context.genRandomSharesType.compare("PRSS") != 0) {
+		std::string error_msg(std::string("Unknown random sharing type: " + context.genRandomSharesType));
+		throw std::runtime_error(error_msg.c_str());
+	}
+	if (context.genRandomSharesType.compare("PRSS") == 0 && context.np > 16) {
+		throw std::runtime_error("PRSS supports at most 16 parties");
+	}
+
 	//Setting OPPRF type
 	if (opprf_type.compare("Poly") == 0) {
 		context.opprf_type = ENCRYPTO::PsiAnalyticsContext::POLY;
@@ -142,6 +189,16 @@ auto read_test_options(int32_t argcp, char **argvp) {
 
 	context.nbins = context.neles * context.epsilon;
 
+	//Setting bit-length for the equality phase of Threshold and Circuit PSI
+	//A false match among the nbins*(np-1) comparisons happens with probability
+	//at most 2^-statsecparam, rounded up to full radix digits
+	context.cmpbitlen = context.bitlen;
+	if(adaptive_bitlen) {
+		std::uint64_t cmpbitlen = context.statsecparam + std::ceil(std::log2(context.nbins * (context.np-1)));
+		cmpbitlen = ((cmpbitlen + context.radixparam - 1) / context.radixparam) * context.radixparam;
+		context.cmpbitlen = std::min(cmpbitlen, context.bitlen);
+	}
+
 	//Setting parameters for polynomial OPPRF, based on Pinkas et al, 2019
 	int logn = int(std::log2(context.neles));
 	if (logn == 12) {
@@ -168,15 +225,28 @@ auto read_test_options(int32_t argcp, char **argvp) {
 	context.outputFileName = "output.txt";
 	context.circuitFileName = "ic.txt";
 	context.partiesFile = "Parties.txt";
-	context.genRandomSharesType = "HIM";
 	context.multType = "DN";
 	context.verifyType = "Single";
 
 	//Setting prime modulus for field in Circuit and Threshold variants
-	//Must be a Mersenne prime > # of parties, less than a byte in length
-	//E.g 31, 127
-	//IF you change this be sure to change the prime and its bitlength in ZpMersenneByteElement.cpp as well
-	context.smallmod = 31;
+	//Must be a Mersenne prime > # of parties + P - 1, so that the packing points 0, -1, ..., -(P-1)
+	//differ from the party points 1..N
+	//The smallest one of the byte primes (31, 127) is chosen, and the 13-bit prime 8191 beyond that
+	uint64_t numPoints = context.np + context.packFactor - 1;
+	if (numPoints < 31) {
+		context.smallmod = 31;
+	} else if (numPoints < 127) {
+		context.smallmod = 127;
+	} else if (numPoints < 8191) {
+		context.smallmod = 8191;
+		if (context.fieldType.compare("ZpMersenneByte") == 0) {
+			context.fieldType = "ZpMersenneShort";
+		}
+	} else if (context.analytics_type == ENCRYPTO::PsiAnalyticsContext::THRESHOLD ||
+		   context.analytics_type == ENCRYPTO::PsiAnalyticsContext::CIRCUIT) {
+		std::string error_msg("Threshold and Circuit variants need the number of parties plus the packing factor to be at most 8191.");
+		throw std::runtime_error(error_msg.c_str());
+	}
 
 	//Setting network parameters
 	if(context.role == P_0) {
@@ -242,6 +312,12 @@ void prepareArgs(ENCRYPTO::PsiAnalyticsContext context, char** circuitArgv) {
 	strcpy(circuitArgv[22], context.partiesFile.c_str());
 	stringToChar(circuitArgv[23], "-internalIterationsNumber");
 	stringToChar(circuitArgv[24], "1");
+	stringToChar(circuitArgv[25], "-conversionType");
+	strcpy(circuitArgv[26], context.conversionType.c_str());
+	stringToChar(circuitArgv[27], "-kingType");
+	strcpy(circuitArgv[28], context.kingType.c_str());
+	stringToChar(circuitArgv[29], "-packFactor");
+	sprintf(circuitArgv[30], "%lu", context.packFactor);
 }
 
 /*
@@ -254,6 +330,14 @@ void MPSI_execution(ENCRYPTO::PsiAnalyticsContext &context, std::vector<std::uin
 	std::vector<std::vector<std::uint64_t>> sub_bins;
 	std::uint64_t int_count;
 
+	//Input-independent MPC preprocessing runs on the libscapi channels alongside the OPPRF phase
+	std::thread offline_thread([&context, &mpsi]() {
+		auto offline_start = std::chrono::system_clock::now();
+		mpsi.runMPSIOffline(context.nbins);
+		const duration_millis offline_time = std::chrono::system_clock::now() - offline_start;
+		context.timings.preprocessing = offline_time.count();
+	});
+
 	switch(context.opprf_type) {
 		case ENCRYPTO::PsiAnalyticsContext::POLY: {
 								  ENCRYPTO::run_psi_analytics(sub_bins, context, inputs, allsocks, chl);
@@ -272,11 +356,12 @@ void MPSI_execution(ENCRYPTO::PsiAnalyticsContext &context, std::vector<std::uin
 
 	//cout << context.role << ": PSI circuit successfully executed: " << bins[0] << endl;
 	//cout << context.role << ": Passing inputs..." << endl;
+	offline_thread.join();
 	mpsi.readMPSIInputs(sub_bins, context.nbins);
 
 	//cout << context.role << ": Running circuit..." << endl;
 	auto t2 = std::chrono::system_clock::now();
-	int_count = mpsi.runMPSI();
+	int_count = mpsi.runMPSIOnline();
 	auto end_time = std::chrono::system_clock::now();
 
 	const duration_millis circuit_time = end_time - t2;
@@ -296,14 +381,23 @@ void MPSI_execution(ENCRYPTO::PsiAnalyticsContext &context, std::vector<std::uin
 /*
  * Run the threshold PSI protocol
  */
+template <class FieldType>
 void MPSI_threshold_execution(ENCRYPTO::PsiAnalyticsContext &context, std::vector<std::uint64_t> &inputs, std::vector<std::unique_ptr<CSocket>> &allsocks,
-			      std::vector<osuCrypto::Channel> &chl, std::vector<sci::NetIO*> ioArr, Threshold<ZpMersenneByteElement> &mpsi) {
+			      std::vector<osuCrypto::Channel> &chl, std::vector<sci::NetIO*> ioArr, Threshold<FieldType> &mpsi) {
 	ResetCommunication(allsocks, chl, context);
 	RELAXEDNS::ResetCommunicationThreshold(ioArr, context);
 	auto start_time = std::chrono::system_clock::now();
-	std::vector<std::vector<std::uint8_t>> sub_bins;
+	std::vector<std::vector<typename FieldType::elem_type>> sub_bins;
 	std::uint64_t int_count;
 
+	//Input-independent MPC preprocessing runs on the libscapi channels alongside the OPPRF phase
+	std::thread offline_thread([&context, &mpsi]() {
+		auto offline_start = std::chrono::system_clock::now();
+		mpsi.runMPSIOffline(context.nbins);
+		const duration_millis offline_time = std::chrono::system_clock::now() - offline_start;
+		context.timings.preprocessing = offline_time.count();
+	});
+
 	switch(context.opprf_type) {
 		case ENCRYPTO::PsiAnalyticsContext::POLY: {
 								  std::string error_msg("Not implemented currently.");
@@ -323,11 +417,12 @@ void MPSI_threshold_execution(ENCRYPTO::PsiAnalyticsContext &context, std::vecto
 
 	//cout << context.role << ": PSI circuit successfully executed: " << bins[0] << endl;
 	//cout << context.role << ": Passing inputs..." << endl;
+	offline_thread.join();
 	mpsi.readMPSIInputs(sub_bins, context.nbins);
 
 	//cout << context.role << ": Running circuit..." << endl;
 	auto t2 = std::chrono::system_clock::now();
-	int_count = mpsi.runMPSI();
+	int_count = mpsi.runMPSIOnline();
 	auto end_time = std::chrono::system_clock::now();
 
 	const duration_millis circuit_time = end_time - t2;
@@ -348,14 +443,23 @@ void MPSI_threshold_execution(ENCRYPTO::PsiAnalyticsContext &context, std::vecto
 /*
  * Run the Circuit PSI protocol
  */
+template <class FieldType>
 void MPSI_circuit_execution(ENCRYPTO::PsiAnalyticsContext &context, std::vector<std::uint64_t> &inputs, std::vector<std::unique_ptr<CSocket>> &allsocks,
-			    std::vector<osuCrypto::Channel> &chl, std::vector<sci::NetIO*> ioArr, CircuitPSI<ZpMersenneByteElement> &mpsi) {
+			    std::vector<osuCrypto::Channel> &chl, std::vector<sci::NetIO*> ioArr, CircuitPSI<FieldType> &mpsi) {
 	ResetCommunication(allsocks, chl, context);
 	RELAXEDNS::ResetCommunicationThreshold(ioArr, context);
 	auto start_time = std::chrono::system_clock::now();
-	std::vector<std::vector<std::uint8_t>> sub_bins;
+	std::vector<std::vector<typename FieldType::elem_type>> sub_bins;
 	std::uint64_t int_count;
 
+	//Input-independent MPC preprocessing runs on the libscapi channels alongside the OPPRF phase
+	std::thread offline_thread([&context, &mpsi]() {
+		auto offline_start = std::chrono::system_clock::now();
+		mpsi.runMPSIOffline(context.nbins);
+		const duration_millis offline_time = std::chrono::system_clock::now() - offline_start;
+		context.timings.preprocessing = offline_time.count();
+	});
+
 	switch(context.opprf_type) {
 		case ENCRYPTO::PsiAnalyticsContext::POLY: {
 								  std::string error_msg("Not implemented currently.");
@@ -374,11 +478,12 @@ void MPSI_circuit_execution(ENCRYPTO::PsiAnalyticsContext &context, std::vector<
 	context.timings.opprf = opprf_time.count();
 
 	//cout << context.role << ": Passing inputs..." << endl;
+	offline_thread.join();
 	mpsi.readMPSIInputs(sub_bins, context.nbins);
 
 	//cout << context.role << ": Running circuit..." << endl;
 	auto t2 = std::chrono::system_clock::now();
-	int_count = mpsi.runMPSI();
+	int_count = mpsi.runMPSIOnline();
 	auto end_time = std::chrono::system_clock::now();
 	const duration_millis circuit_time = end_time - t2;
 
@@ -473,11 +578,11 @@ int main(int argc, char **argv) {
 	}*/
 
 	if (context.analytics_type == ENCRYPTO::PsiAnalyticsContext::THRESHOLD) {
-		size = 29;
+		size = 35;
 	} else if (context.analytics_type == ENCRYPTO::PsiAnalyticsContext::CIRCUIT) {
-		size = 27;
+		size = 33;
 	} else {
-		size = 25;
+		size = 31;
 	}
 
 	circuitArgv = (char **) malloc(sizeof(char*)*(size));
@@ -487,14 +592,14 @@ int main(int argc, char **argv) {
 
 	prepareArgs(context, circuitArgv);
 	if(context.analytics_type == ENCRYPTO::PsiAnalyticsContext::THRESHOLD) {
-		stringToChar(circuitArgv[25], "-threshold");
-		sprintf(circuitArgv[26], "%lu", context.threshold);
-		stringToChar(circuitArgv[27], "-primemod");
-		sprintf(circuitArgv[28], "%d", context.smallmod);
+		stringToChar(circuitArgv[31], "-threshold");
+		sprintf(circuitArgv[32], "%lu", context.threshold);
+		stringToChar(circuitArgv[33], "-primemod");
+		sprintf(circuitArgv[34], "%d", context.smallmod);
 	}
 	else if(context.analytics_type == ENCRYPTO::PsiAnalyticsContext::CIRCUIT) {
-		stringToChar(circuitArgv[25], "-primemod");
-		sprintf(circuitArgv[26], "%d", context.smallmod);
+		stringToChar(circuitArgv[31], "-primemod");
+		sprintf(circuitArgv[32], "%d", context.smallmod);
 	}
 
 	auto parameters = parser.parseArguments("", size, circuitArgv);
@@ -541,16 +646,36 @@ int main(int argc, char **argv) {
 							 break;
 
 		case ENCRYPTO::PsiAnalyticsContext::THRESHOLD: {
-								       Threshold<ZpMersenneByteElement> mpsi(size, circuitArgv);
-								       synchronize_parties(context, allsocks, chl, ios, ep);
-								       MPSI_threshold_execution(context, inputs, allsocks, chl, ioArr, mpsi);
+								       if (context.smallmod == 31) {
+									       Threshold<ZpMersenneByteElement<31>> mpsi(size, circuitArgv);
+									       synchronize_parties(context, allsocks, chl, ios, ep);
+									       MPSI_threshold_execution(context, inputs, allsocks, chl, ioArr, mpsi);
+								       } else if (context.smallmod == 127) {
+									       Threshold<ZpMersenneByteElement<127>> mpsi(size, circuitArgv);
+									       synchronize_parties(context, allsocks, chl, ios, ep);
+									       MPSI_threshold_execution(context, inputs, allsocks, chl, ioArr, mpsi);
+								       } else {
+									       Threshold<ZpMersenneShortElement> mpsi(size, circuitArgv);
+									       synchronize_parties(context, allsocks, chl, ios, ep);
+									       MPSI_threshold_execution(context, inputs, allsocks, chl, ioArr, mpsi);
+								       }
 							       }
 							       break;
 
 		case ENCRYPTO::PsiAnalyticsContext::CIRCUIT: {
-								     CircuitPSI<ZpMersenneByteElement> mpsi(size, circuitArgv);
-								     synchronize_parties(context, allsocks, chl, ios, ep);
-								     MPSI_circuit_execution(context, inputs, allsocks, chl, ioArr, mpsi);
+								     if (context.smallmod == 31) {
+									     CircuitPSI<ZpMersenneByteElement<31>> mpsi(size, circuitArgv);
+									     synchronize_parties(context, allsocks, chl, ios, ep);
+									     MPSI_circuit_execution(context, inputs, allsocks, chl, ioArr, mpsi);
+								     } else if (context.smallmod == 127) {
+									     CircuitPSI<ZpMersenneByteElement<127>> mpsi(size, circuitArgv);
+									     synchronize_parties(context, allsocks, chl, ios, ep);
+									     MPSI_circuit_execution(context, inputs, allsocks, chl, ioArr, mpsi);
+								     } else {
+									     CircuitPSI<ZpMersenneShortElement> mpsi(size, circuitArgv);
+									     synchronize_parties(context, allsocks, chl, ios, ep);
+									     MPSI_circuit_execution(context, inputs, allsocks, chl, ioArr, mpsi);
+								     }
 							     }
 							     break;
 